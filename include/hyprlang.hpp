@@ -6,14 +6,25 @@
 #include <typeindex>
 #include <any>
 #include <string>
+#include <string_view>
 #include <ostream>
 #include <vector>
+#include <memory>
+#include <span>
+#include <future>
+#include <optional>
 #include <print>
 #include <cstdlib>
 
 class CConfigImpl;
+class CValueArena;
+class CConfigSource;
 struct SConfigDefaultValue;
 struct SSpecialCategory;
+struct SParseErrorList;
+struct SConfigSnapshotData;
+struct SParseFrame;
+struct SParseStep;
 
 #define HYPRLANG_END_MAGIC 0x1337BEEF
 
@@ -65,6 +76,31 @@ namespace Hyprlang {
         }
     };
 
+    /*!
+        \since 0.7.0
+
+        What kind of error a SParseError is.
+    */
+    enum eParseErrorCode : uint8_t {
+        PARSE_ERROR_STATEMENT = 0,      // a line failed, see message
+        PARSE_ERROR_TRAILING_BACKSLASH, // the last line ends with a backslash
+        PARSE_ERROR_UNCLOSED_CATEGORY,  // a category is still open at EOF
+    };
+
+    /*!
+        \since 0.7.0
+
+        One error collected while parsing. Strings stay valid as long as the CParseResult
+        it came from, or a copy of it, does.
+    */
+    struct SParseError {
+        const char*     file    = nullptr; // nullptr when parsing a stream
+        int             line    = 0;       // 0 if not tied to a line
+        int             column  = 0;       // where the statement starts, 0 if not tied to a line
+        eParseErrorCode code    = PARSE_ERROR_STATEMENT;
+        const char*     message = "";
+    };
+
     class CParseResult {
       public:
         bool error = false;
@@ -73,20 +109,32 @@ namespace Hyprlang {
             Pointer valid until the error string is changed or this
             object gets destroyed.
         */
-        const char* getError() const {
-            return errorString;
-        }
+        const char* getError() const;
         /*!
             Set an error contained by this ParseResult.
             Creates a copy of the string, does not take ownership.
         */
         void setError(const char* err);
 
+        /*!
+            \since 0.7.0
+
+            All errors collected by a parse(), in order. getError() joins these.
+            Empty for results that only carry a message.
+            Valid as long as this ParseResult. One a handler gets from parseFile() during a parse
+            only until that parse goes on.
+        */
+        std::span<const SParseError> getErrors() const;
+
       private:
-        void        setError(const std::string& err);
+        void                                   setError(const std::string& err);
+        void                                   setErrors(std::shared_ptr<const SParseErrorList> list, size_t count);
 
-        std::string errorStdString = "";
-        const char* errorString    = nullptr;
+        mutable std::string                    errorStdString = "";
+        mutable const char*                    errorString    = nullptr;
+
+        std::shared_ptr<const SParseErrorList> errorList;      // the error string is joined from these when first asked for
+        size_t                                 errorCount = 0; // errors appended after this result was made aren't ours
 
         friend class CConfig;
     };
@@ -119,6 +167,101 @@ namespace Hyprlang {
         */
         int pathIsStream = false;
 
+        /*!
+            \since 0.7.0
+
+            Collect counters and timings while parsing, see CConfig::getParseStats().
+        */
+        int collectStats = false;
+
+        /*!
+            \since 0.7.0
+
+            Publish a read-only copy of all values after every parse() and parseDynamic(),
+            see CConfig::getSnapshot().
+        */
+        int publishSnapshots = false;
+
+        /*!
+            \since 0.7.0
+
+            Handle source = path in the parser, instead of a handler calling parseFile().
+            ~ is $HOME, relative paths start at the sourcing file's directory and globs are expanded.
+            A file sourcing itself, directly or not, is an error.
+            Files reachable through source lines outside of hyprlang if blocks are read ahead on a few threads,
+            started by the first source line a parse meets. step() counts lines of sourced files against its budget.
+        */
+        int builtinSource = false;
+
+        /*!
+            \since 0.7.0
+
+            Make parse() a no-op returning the last result if nothing it read changed since:
+            the root file, files parsed with parseFile() or source lines, and the env variables used.
+            Files are compared by mtime and size, and by contents if those differ.
+            A parseDynamic() or a change to values, categories or handlers always parses again.
+            Handlers don't run when it's skipped, and files they find on their own, e.g. by globbing, aren't watched until parsed.
+        */
+        int skipUnchanged = false;
+
+        // INTERNAL: DO NOT MODIFY
+        int __internal_struct_end = HYPRLANG_END_MAGIC;
+    };
+
+    /*!
+        \since 0.7.0
+    */
+    enum eConfigChangeType : uint8_t {
+        CONFIG_CHANGE_VALUE = 0,       // a plain value
+        CONFIG_CHANGE_SPECIAL_VALUE,   // a value of a special category
+        CONFIG_CHANGE_SPECIAL_ADDED,   // a special category appeared
+        CONFIG_CHANGE_SPECIAL_REMOVED, // a special category is gone
+    };
+
+    /*!
+        \since 0.7.0
+
+        Something whose effective value differs from before the last parse() or parseDynamic().
+    */
+    struct SConfigChange {
+        eConfigChangeType type     = CONFIG_CHANGE_VALUE;
+        const char*       name     = ""; // name of the value, "" for added and removed categories
+        const char*       category = ""; // special category, "" for plain values
+        const char*       key      = ""; // key of the special category, "" for static ones
+    };
+
+    /*!
+        \since 0.7.0
+
+        What the last parse() did, see SConfigOptions::collectStats.
+        Times are cumulative nanoseconds of a monotonic clock.
+    */
+    struct SParseStats {
+        size_t   linesRead                = 0; // logical lines, continuations joined
+        size_t   bytesRead                = 0;
+        size_t   variableSubstitutions    = 0;
+        size_t   expansionIterations      = 0; // passes over a string, one more for every nested reference
+        size_t   expressionsEvaluated     = 0;
+        size_t   specialCategoriesCreated = 0;
+        size_t   handlerCalls             = 0; // keyword handlers and custom value handlers
+
+        uint64_t readNs            = 0; // opening and reading files
+        uint64_t variableNs        = 0;
+        uint64_t expressionNs      = 0;
+        uint64_t specialCategoryNs = 0; // finding and creating special categories
+        uint64_t handlerNs         = 0; // not counting files handlers parse themselves
+        uint64_t totalNs           = 0;
+    };
+
+    /*!
+        \since 0.7.0
+
+        How much one CConfig::step() may do. It always parses at least one line.
+    */
+    struct SParseBudget {
+        uint64_t ns    = 0; // time, 0 for no limit
+        size_t   lines = 0; // 0 for no limit
+
         // INTERNAL: DO NOT MODIFY
         int __internal_struct_end = HYPRLANG_END_MAGIC;
     };
@@ -132,6 +275,14 @@ namespace Hyprlang {
         */
         bool allowFlags = false;
 
+        /*!
+            \since 0.7.0
+
+            With parseAsync(), don't call this handler on the worker thread.
+            Its calls are queued and made by applyPending(), in order, after the parsed values are applied.
+        */
+        int mainThreadOnly = false;
+
         // INTERNAL: DO NOT MODIFY
         int __internal_struct_end = HYPRLANG_END_MAGIC;
     };
@@ -174,6 +325,45 @@ namespace Hyprlang {
     typedef CParseResult (*PCONFIGCUSTOMVALUEHANDLERFUNC)(const char* VALUE, void** data);
     typedef void (*PCONFIGCUSTOMVALUEDESTRUCTOR)(void** data);
 
+    /*!
+        \since 0.7.0
+    */
+    enum eTraceSpan : uint8_t {
+        TRACE_SPAN_PARSE = 0,    // a whole parse()
+        TRACE_SPAN_FILE,         // a parseFile(), also nested ones from handlers
+        TRACE_SPAN_HANDLER,      // a call to a registered handler
+        TRACE_SPAN_CUSTOM_VALUE, // a call to a custom value's handler
+    };
+
+    /*!
+        \since 0.7.0
+
+        A span beginning or ending. Strings are only valid during the callback.
+    */
+    struct STraceEvent {
+        bool        begin     = true;
+        eTraceSpan  span      = TRACE_SPAN_PARSE;
+        const char* name      = "";      // "parse", the file path, the handler name or the value name
+        const char* file      = nullptr; // file the span started in, nullptr for streams and parseDynamic
+        int         line      = 0;       // line the span started at, 0 if none
+        uint64_t    timestamp = 0;       // nanoseconds, monotonic clock
+    };
+
+    typedef void (*PCONFIGTRACEFUNC)(const STraceEvent& event, void* data);
+
+    /*!
+        \since 0.7.0
+
+        A change handed to a change listener.
+    */
+    struct SConfigValueChange {
+        const SConfigChange* change = nullptr;
+        std::any             before; // the value before, empty for added and removed special categories and custom values
+        std::any             after;  // same as getValue() on the value now, empty for added and removed special categories. Strings are copies.
+    };
+
+    typedef void (*PCONFIGCHANGEFUNC)(std::span<const SConfigValueChange> changes, void* data);
+
     /*!
         Container for a custom config value type
         When creating, pass your handler.
@@ -287,15 +477,99 @@ namespace Hyprlang {
             CONFIGDATATYPE_VEC2,
             CONFIGDATATYPE_CUSTOM,
         };
-        eDataType m_eType = eDataType::CONFIGDATATYPE_EMPTY;
-        void*     m_pData = nullptr;
-        void      defaultFrom(SConfigDefaultValue& ref);
-        void      setFrom(std::any ref);
-        void      setFrom(const CConfigValue* const ref);
+        bool                m_bArenaBacked = false; // m_pData is owned by the CConfig's CValueArena. Fits in the padding after m_bSetByUser.
+        eDataType           m_eType        = eDataType::CONFIGDATATYPE_EMPTY;
+        void*               m_pData        = nullptr;
+        void                defaultFrom(SConfigDefaultValue& ref, CValueArena* arena = nullptr);
+        SConfigDefaultValue asDefault() const;
+        void                setFrom(const CConfigValue* const ref);
+        void                setInt(INT value);
+        void                setFloat(FLOAT value);
+        void                setVec2(const VEC2& value);
+        void                setString(std::string_view str, CValueArena* arena = nullptr);
+        void                assignFrom(const CConfigValue& other, CValueArena* arena); // same type, e.g. from another config
+        void                snapshot(SConfigDefaultValue& out) const; // effective value, reuses out's storage
+        bool                sameAs(const SConfigDefaultValue& ref) const;
+
+        friend class CConfig;
+        friend class ::CValueArena;
+        friend class ::CConfigImpl;
+    };
+
+    class CConfig;
+
+    /*!
+        A config value name resolved once, for repeated lookups.
+        Obtain one with CConfig::getConfigValueHandle.
+
+        Handles to basic values always point to the same value.
+        Handles to `category[key]:name` values re-resolve on their own
+        once special categories change, e.g. after a parse().
+
+        A handle must not outlive the CConfig it came from.
+
+        \since 0.7.0
+    */
+    class CConfigValueHandle {
+      public:
+        /*!
+            Get the value ptr. nullptr if it doesn't exist (anymore).
+            Same lifetime rules as getAnyConfigValuePtr apply.
+        */
+        CConfigValue* get();
+
+      private:
+        CConfig*      m_pConfig     = nullptr;
+        CConfigValue* m_pValue      = nullptr;
+        size_t        m_iGeneration = 0;
+        bool          m_bSpecial    = false;
+        std::string   m_category    = "";
+        std::string   m_key         = "";
+        std::string   m_name        = "";
+
+        void          resolve();
 
         friend class CConfig;
     };
 
+    /*!
+        An immutable copy of every value, as of the end of one parse() or parseDynamic().
+        Safe to read from any thread while the config is parsed again.
+        Obtain one with CConfig::getSnapshot, it stays alive as long as someone holds it.
+
+        Values that didn't change are shared between snapshots.
+        Custom values are kept as the string they were set from, getValue() on them gives a const char*.
+
+        \since 0.7.0
+    */
+    class CConfigSnapshot {
+      public:
+        ~CConfigSnapshot();
+
+        /*!
+            nullptr if it doesn't exist.
+        */
+        const CConfigValue* getConfigValuePtr(std::string_view name) const;
+
+        /*!
+            key is empty for static (key-less) categories.
+            nullptr if it doesn't exist.
+        */
+        const CConfigValue* getSpecialConfigValuePtr(std::string_view category, std::string_view name, std::string_view key = "") const;
+
+        /*!
+            Counts up with every published snapshot.
+        */
+        size_t generation() const;
+
+      private:
+        CConfigSnapshot();
+
+        std::unique_ptr<SConfigSnapshotData> m_pData;
+
+        friend class ::CConfigImpl;
+    };
+
     /*!
         Base class for a config file
     */
@@ -358,9 +632,90 @@ namespace Hyprlang {
 
         /*!
             Parse the config. Refresh the values.
+            Cancels a parse that is still pending.
+            See SConfigOptions::skipUnchanged.
         */
         CParseResult parse();
 
+        /*!
+            Same as parse(). With force, it parses even if skipUnchanged would skip it,
+            and doesn't load the cache file.
+
+            \since 0.7.0
+        */
+        CParseResult parse(bool force);
+
+        /*!
+            Keep a compiled copy of the last parse without errors at path.
+            The first parse() loads it instead of parsing when the files, env variables and schema
+            (values, special categories, handlers) it was made from are the same, and parses if anything differs.
+            Handlers are called again with what they got, in order, but only once all values are in place.
+            Configs with handlers calling parseFile() aren't cached, see SConfigOptions::builtinSource.
+            nullptr turns it off.
+
+            \since 0.7.0
+        */
+        void setCacheFile(const char* path);
+
+        /*!
+            Parse the config on a worker thread. Nothing visible changes until applyPending().
+            The future is ready, and getPendingFD() readable, once applyPending() won't block.
+
+            Handlers run on the worker unless registered with mainThreadOnly.
+            Getters and parseFile() called from them go to the pending parse, so like with parse(), they see what earlier lines set.
+            Pointers they get stay valid for the lifetime of the config, but only follow parseAsync() and beginParse().
+            Don't add or remove handlers and special categories, or change values, while a parse is pending.
+
+            Cancels a parse that is still pending.
+
+            \since 0.7.0
+        */
+        std::future<void> parseAsync();
+
+        /*!
+            Wait for the pending parseAsync(), then apply it on this thread
+            and call the mainThreadOnly handlers it queued.
+            Returns what parse() would have.
+
+            \since 0.7.0
+        */
+        CParseResult applyPending();
+
+        /*!
+            An eventfd that is readable while a finished parseAsync() waits for applyPending().
+            The same fd for the lifetime of the config, -1 before the first parseAsync().
+
+            \since 0.7.0
+        */
+        int getPendingFD() const;
+
+        /*!
+            Start a parse that step() does a bit at a time, e.g. from an event loop.
+            Like parseAsync(), nothing visible changes until the last step.
+            Handlers run during the step that reaches their line, on the calling thread.
+            Like with parseAsync(), getters called from them go to the pending parse.
+            Cancels a parse that is still pending.
+
+            \since 0.7.0
+        */
+        void beginParse();
+
+        /*!
+            Parse lines until budget is used up. Empty while there's more to do,
+            the last step applies the parse and returns what parse() would have.
+
+            \since 0.7.0
+        */
+        std::optional<CParseResult> step(const SParseBudget& budget);
+
+        /*!
+            Drop the pending parse of beginParse() or parseAsync(), if any.
+            The values stay as they are. An async one is stopped at the next line, this waits for that.
+
+            \since 0.7.0
+        */
+        void cancelParse();
+
         /*!
             Same as parse(), but parse a specific file, without any refreshing.
             recommended to use for stuff like source = path.conf
@@ -381,6 +736,13 @@ namespace Hyprlang {
         */
         CConfigValue* getConfigValuePtr(const char* name);
 
+        /*!
+            \since 0.7.0
+
+            Same as above, the name does not have to be null-terminated.
+        */
+        CConfigValue* getConfigValuePtr(std::string_view name);
+
         /*!
            Get a special category's config value ptr. These are only static for static (key-less)
            categories.
@@ -401,6 +763,16 @@ namespace Hyprlang {
         */
         CConfigValue* getAnyConfigValuePtr(const char* name);
 
+        /*!
+           Resolve a basic or special category's config value name into a handle,
+           for paths that look up the same value over and over.
+
+           Same syntax as getAnyConfigValuePtr.
+
+           \since 0.7.0
+        */
+        CConfigValueHandle getConfigValueHandle(const char* name);
+
         /*!
             Get a config value's stored value. Empty on fail
         */
@@ -476,18 +848,101 @@ namespace Hyprlang {
         */
         void changeRootPath(const char* path);
 
+        /*!
+            Counters and timings of the last parse(), files parsed by handlers during it included.
+            All zero unless collectStats is set in the options.
+
+            \since 0.7.0
+        */
+        const SParseStats& getParseStats() const;
+
+        /*!
+            Everything that changed during the last parse() or parseDynamic().
+            Valid until the next one.
+
+            \since 0.7.0
+        */
+        std::span<const SConfigChange> getChanges() const;
+
+        /*!
+            Call func once at the end of every parse() or parseDynamic() that changed something
+            matching pattern, with all of those changes.
+
+            pattern is either
+             - a value name, e.g. general:border_size,
+             - a prefix ending in *, e.g. decoration:*,
+             - a special category name, which matches its values and it being added or removed.
+            Special category values are matched as category:value.
+
+            \since 0.7.0
+        */
+        void addChangeListener(const char* pattern, PCONFIGCHANGEFUNC func, void* data = nullptr);
+
+        /*!
+            Remove a listener added with the same pattern and func.
+
+            \since 0.7.0
+        */
+        void removeChangeListener(const char* pattern, PCONFIGCHANGEFUNC func);
+
+        /*!
+            The latest snapshot, nullptr unless publishSnapshots is set and something was parsed.
+            Never blocks, any thread can call this while another one parses.
+
+            \since 0.7.0
+        */
+        std::shared_ptr<const CConfigSnapshot> getSnapshot() const;
+
+        /*!
+            Call func with data for every span begin and end while parsing.
+            Replaces writeTrace(). nullptr stops tracing.
+
+            \since 0.7.0
+        */
+        void setTraceCallback(PCONFIGTRACEFUNC func, void* data = nullptr);
+
+        /*!
+            Write every span to path in the Chrome trace event format,
+            loadable in chrome://tracing or Perfetto. Replaces a trace callback.
+            The file is finished by setTraceCallback(nullptr) or destroying the config.
+            Returns false if path couldn't be opened.
+
+            \since 0.7.0
+        */
+        bool writeTrace(const char* path);
+
       private:
         bool                          m_bCommenced = false;
 
         CConfigImpl*                  impl;
 
-        CParseResult                  parseLine(std::string line, bool dynamic = false);
-        std::pair<bool, CParseResult> configSetValueSafe(const std::string& command, const std::string& value);
-        CParseResult                  parseVariable(const std::string& lhs, const std::string& rhs, bool dynamic = false);
+        CParseResult                  parseLine(std::string_view line, bool dynamic = false);
+        std::pair<bool, CParseResult> configSetValueSafe(std::string_view command, std::string_view value);
+        CParseResult                  parseVariable(std::string_view lhs, std::string_view rhs, bool dynamic = false);
         void                          clearState();
+        CParseResult                  reparse();
+        void                          beginReparse();
+        bool                          continueReparse(const SParseBudget& budget);
+        void                          abortReparse();
+        bool                          openFrame(SParseFrame& frame, const char* file, std::shared_ptr<CConfigSource> prefetched = nullptr);
+        bool                          parseFrame(SParseFrame& frame, SParseStep* step = nullptr);
+        void                          closeFrame(SParseFrame& frame);
+        CParseResult                  finishFrame(SParseFrame& frame);
+        CParseResult                  parseSource(std::string_view value);
+        void                          resetToDefaults();
+        std::optional<CParseResult>   loadCache();
+        bool                          readCache(std::string_view data, uint64_t schemaHash);
+        void                          writeCache();
+        CParseResult                  finishParse(CParseResult result, bool fromCache);
+        void                          beginPending();
+        void                          runPending();
+        void                          prepareStaging();
+        void                          commitStaging();
         void                          applyDefaultsToCat(SSpecialCategory& cat);
         void                          retrieveKeysForCat(const char* category, const char*** out, size_t* len);
         CParseResult                  parseRawStream(const std::string& stream);
+
+        friend class CConfigValueHandle;
     };
 
     /*!
@@ -0,0 +1,90 @@
+#include "arena.hpp"
+
+#include <bit>
+
+using namespace Hyprlang;
+
+int64_t* CValueArena::allocInt() {
+    return m_ints.alloc();
+}
+
+float* CValueArena::allocFloat() {
+    return m_floats.alloc();
+}
+
+SVector2D* CValueArena::allocVec2() {
+    return m_vec2s.alloc();
+}
+
+char* CValueArena::allocString(size_t len) {
+    const size_t CAPACITY  = std::max<size_t>(16, std::bit_ceil(len + 1));
+    const size_t SIZECLASS = std::countr_zero(CAPACITY) - 4;
+
+    if (SIZECLASS >= STRING_SIZE_CLASSES)
+        throw "string too long for the value arena";
+
+    SStringHeader* header = nullptr;
+
+    if (!m_vStringFree[SIZECLASS].empty()) {
+        header = m_vStringFree[SIZECLASS].back();
+        m_vStringFree[SIZECLASS].pop_back();
+    } else {
+        const size_t NEEDED = sizeof(SStringHeader) + CAPACITY;
+
+        if (NEEDED > STRING_CHUNK_SIZE / 4) {
+            // big ones get their own chunk, so they don't waste the tail of a shared one
+            header = reinterpret_cast<SStringHeader*>(m_vStringChunks.emplace_back(std::make_unique<std::byte[]>(NEEDED)).get());
+        } else {
+            if (!m_pStringChunk || m_stringChunkUsed + NEEDED > STRING_CHUNK_SIZE) {
+                m_pStringChunk    = m_vStringChunks.emplace_back(std::make_unique<std::byte[]>(STRING_CHUNK_SIZE)).get();
+                m_stringChunkUsed = 0;
+            }
+
+            header = reinterpret_cast<SStringHeader*>(m_pStringChunk + m_stringChunkUsed);
+            m_stringChunkUsed += NEEDED;
+        }
+
+        new (header) SStringHeader{.arena = this, .capacity = (uint32_t)CAPACITY};
+    }
+
+    header->length = len;
+
+    return reinterpret_cast<char*>(header + 1);
+}
+
+void CValueArena::releaseString(char* str) {
+    const auto HEADER = reinterpret_cast<SStringHeader*>(str) - 1;
+    m_vStringFree[std::countr_zero(HEADER->capacity) - 4].emplace_back(HEADER);
+}
+
+CValueArena* CValueArena::arenaOf(const char* str) {
+    return (reinterpret_cast<const SStringHeader*>(str) - 1)->arena;
+}
+
+size_t CValueArena::capacityOf(const char* str) {
+    return (reinterpret_cast<const SStringHeader*>(str) - 1)->capacity;
+}
+
+size_t CValueArena::lengthOf(const char* str) {
+    return (reinterpret_cast<const SStringHeader*>(str) - 1)->length;
+}
+
+void CValueArena::setLength(char* str, size_t len) {
+    (reinterpret_cast<SStringHeader*>(str) - 1)->length = len;
+}
+
+void CValueArena::release(CConfigValue& value) {
+    if (!value.m_bArenaBacked || !value.m_pData)
+        return;
+
+    switch (value.m_eType) {
+        case CConfigValue::CONFIGDATATYPE_INT: m_ints.release((int64_t*)value.m_pData); break;
+        case CConfigValue::CONFIGDATATYPE_FLOAT: m_floats.release((float*)value.m_pData); break;
+        case CConfigValue::CONFIGDATATYPE_VEC2: m_vec2s.release((SVector2D*)value.m_pData); break;
+        case CConfigValue::CONFIGDATATYPE_STR: releaseString((char*)value.m_pData); break;
+        default: break;
+    }
+
+    value.m_pData        = nullptr;
+    value.m_bArenaBacked = false;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "public.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+    Owns the payloads of every CConfigValue in one CConfig.
+    Payloads of one type are packed into chunks that never move, so the
+    pointers handed out by getDataStaticPtr() stay valid. Released slots
+    go onto per-type freelists and everything is freed with the arena.
+*/
+class CValueArena {
+  public:
+    CValueArena()                              = default;
+    CValueArena(const CValueArena&)            = delete;
+    CValueArena& operator=(const CValueArena&) = delete;
+
+    int64_t*             allocInt();
+    float*               allocFloat();
+    Hyprlang::SVector2D* allocVec2();
+
+    // room for len chars plus the terminator
+    char* allocString(size_t len);
+    void  releaseString(char* str);
+
+    // hand the payload of an arena-backed value back, the value is left without one
+    void                release(Hyprlang::CConfigValue& value);
+
+    static CValueArena* arenaOf(const char* str);
+    static size_t       capacityOf(const char* str); // terminator included
+    static size_t       lengthOf(const char* str);
+    static void         setLength(char* str, size_t len);
+
+  private:
+    template <typename T>
+    class CPool {
+      public:
+        T* alloc() {
+            if (!m_vFree.empty()) {
+                T* p = m_vFree.back();
+                m_vFree.pop_back();
+                return p;
+            }
+
+            if (m_vChunks.empty() || m_used == m_capacity) {
+                m_capacity = m_vChunks.empty() ? 64 : std::min<size_t>(m_capacity * 2, 4096);
+                m_used     = 0;
+                m_vChunks.emplace_back(std::make_unique<T[]>(m_capacity));
+            }
+
+            return &m_vChunks.back()[m_used++];
+        }
+
+        void release(T* p) {
+            m_vFree.emplace_back(p);
+        }
+
+      private:
+        std::vector<std::unique_ptr<T[]>> m_vChunks;
+        std::vector<T*>                   m_vFree;
+        size_t                            m_used     = 0;
+        size_t                            m_capacity = 0;
+    };
+
+    // sits right in front of the chars of every string
+    struct SStringHeader {
+        CValueArena* arena    = nullptr;
+        uint32_t     capacity = 0;
+        uint32_t     length   = 0;
+    };
+
+    // capacities are powers of two from 16 bytes up
+    constexpr static size_t                    STRING_SIZE_CLASSES = 28;
+    constexpr static size_t                    STRING_CHUNK_SIZE   = 16384;
+
+    CPool<int64_t>                             m_ints;
+    CPool<float>                               m_floats;
+    CPool<Hyprlang::SVector2D>                 m_vec2s;
+
+    std::vector<std::unique_ptr<std::byte[]>>  m_vStringChunks;
+    std::byte*                                 m_pStringChunk    = nullptr; // the one small strings are carved from
+    size_t                                     m_stringChunkUsed = 0;
+    std::array<std::vector<SStringHeader*>, STRING_SIZE_CLASSES> m_vStringFree;
+};
@@ -0,0 +1,132 @@
+#include "cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+uint64_t hashBytes(std::string_view data) {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (const char c : data) {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+void CCacheWriter::u8(uint8_t v) {
+    m_data.push_back((char)v);
+}
+
+void CCacheWriter::u32(uint32_t v) {
+    m_data.append((const char*)&v, sizeof(v));
+}
+
+void CCacheWriter::u64(uint64_t v) {
+    m_data.append((const char*)&v, sizeof(v));
+}
+
+void CCacheWriter::f32(float v) {
+    m_data.append((const char*)&v, sizeof(v));
+}
+
+void CCacheWriter::str(std::string_view v) {
+    u32(v.length());
+    m_data.append(v);
+}
+
+const std::string& CCacheWriter::data() const {
+    return m_data;
+}
+
+bool CCacheWriter::writeTo(const std::string& path) const {
+    const std::string TMP = path + ".tmp";
+
+    {
+        std::ofstream file(TMP, std::ios::binary | std::ios::trunc);
+        if (!file.good())
+            return false;
+
+        const uint64_t CHECKSUM = hashBytes(m_data);
+        file.write(m_data.data(), m_data.length());
+        file.write((const char*)&CHECKSUM, sizeof(CHECKSUM));
+        if (!file.good()) {
+            file.close();
+            std::remove(TMP.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(TMP.c_str(), path.c_str()) == 0;
+}
+
+CCacheReader::CCacheReader(std::string_view data) {
+    uint64_t checksum = 0;
+
+    if (data.length() < sizeof(checksum)) {
+        m_bGood = false;
+        return;
+    }
+
+    std::memcpy(&checksum, data.data() + data.length() - sizeof(checksum), sizeof(checksum));
+    m_data  = data.substr(0, data.length() - sizeof(checksum));
+    m_bGood = hashBytes(m_data) == checksum;
+}
+
+bool CCacheReader::take(void* out, size_t len) {
+    if (!m_bGood || m_data.length() - m_pos < len) {
+        m_bGood = false;
+        std::memset(out, 0, len);
+        return false;
+    }
+
+    std::memcpy(out, m_data.data() + m_pos, len);
+    m_pos += len;
+    return true;
+}
+
+uint8_t CCacheReader::u8() {
+    uint8_t v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+uint32_t CCacheReader::u32() {
+    uint32_t v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+uint64_t CCacheReader::u64() {
+    uint64_t v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+float CCacheReader::f32() {
+    float v;
+    take(&v, sizeof(v));
+    return v;
+}
+
+std::string_view CCacheReader::str() {
+    const auto LEN = u32();
+
+    if (!m_bGood || m_data.length() - m_pos < LEN) {
+        m_bGood = false;
+        return {};
+    }
+
+    const auto STR = m_data.substr(m_pos, LEN);
+    m_pos += LEN;
+    return STR;
+}
+
+bool CCacheReader::good() const {
+    return m_bGood;
+}
+
+bool CCacheReader::atEnd() const {
+    return m_pos == m_data.length();
+}
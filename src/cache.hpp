@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// FNV-1a. Unlike std::hash, the same for every run and build, so it can be written to disk.
+uint64_t hashBytes(std::string_view data);
+
+/*
+    Builds the contents of a cache file. Numbers are written as they are in memory,
+    a cache is only ever read on the machine that wrote it.
+*/
+class CCacheWriter {
+  public:
+    void               u8(uint8_t v);
+    void               u32(uint32_t v);
+    void               u64(uint64_t v);
+    void               f32(float v);
+    void               str(std::string_view v);
+
+    const std::string& data() const;
+
+    // with a checksum of everything at the end, to path.tmp first, so a reader never sees half a file
+    bool               writeTo(const std::string& path) const;
+
+  private:
+    std::string m_data;
+};
+
+/*
+    Reads what a CCacheWriter wrote. Reading past the end returns zeroes and empty strings
+    and makes good() false, so callers only check once they're done.
+    Data with a checksum that doesn't match is never good(). Strings view into data.
+*/
+class CCacheReader {
+  public:
+    CCacheReader(std::string_view data);
+
+    uint8_t          u8();
+    uint32_t         u32();
+    uint64_t         u64();
+    float            f32();
+    std::string_view str();
+
+    bool             good() const;
+    bool             atEnd() const;
+
+  private:
+    bool             take(void* out, size_t len);
+
+    std::string_view m_data;
+    size_t           m_pos   = 0;
+    bool             m_bGood = true;
+};
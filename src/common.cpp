@@ -1,6 +1,8 @@
 #include "public.hpp"
 #include "config.hpp"
 #include <cstring>
+#include <format>
+#include <iterator>
 
 using namespace Hyprlang;
 
@@ -8,16 +10,87 @@ void CParseResult::setError(const std::string& err) {
     error          = true;
     errorStdString = err;
     errorString    = errorStdString.c_str();
+    errorList.reset();
+    errorCount = 0;
 }
 
 void CParseResult::setError(const char* err) {
     error          = true;
     errorStdString = err;
     errorString    = errorStdString.c_str();
+    errorList.reset();
+    errorCount = 0;
+}
+
+void CParseResult::setErrors(std::shared_ptr<const SParseErrorList> list, size_t count) {
+    error      = true;
+    errorList  = std::move(list);
+    errorCount = count;
+    errorStdString.clear();
+    errorString = nullptr;
+}
+
+const char* CParseResult::getError() const {
+    if (errorList && !errorString)
+        errorStdString = errorList->join(errorCount);
+
+    // re-point every time, copies of a result would otherwise point at the original's string
+    if (errorList || errorString)
+        errorString = errorStdString.c_str();
+
+    return errorString;
+}
+
+std::span<const SParseError> CParseResult::getErrors() const {
+    if (!errorList)
+        return {};
+
+    return std::span<const SParseError>{errorList->errors.data(), errorCount};
+}
+
+void SParseErrorList::add(eParseErrorCode code, const char* file, int line, int column, std::string_view message) {
+    // consecutive errors are mostly from the same file, don't store its name every time
+    if (file && (errors.empty() || !errors.back().file || std::strcmp(errors.back().file, file) != 0))
+        file = strings.emplace_back(file).c_str();
+    else if (file)
+        file = errors.back().file;
+
+    errors.emplace_back(SParseError{.file = file, .line = line, .column = column, .code = code, .message = strings.emplace_back(message).c_str()});
+}
+
+std::string SParseErrorList::join(size_t count) const {
+    std::string out;
+
+    for (size_t i = 0; i < count && i < errors.size(); ++i) {
+        const auto& E = errors[i];
+
+        if (!out.empty())
+            out += '\n';
+
+        if (E.code == PARSE_ERROR_STATEMENT) {
+            if (E.file)
+                std::format_to(std::back_inserter(out), "Config error in file {} at line {}: {}", E.file, E.line, E.message);
+            else
+                std::format_to(std::back_inserter(out), "Config error at line {}: {}", E.line, E.message);
+        } else {
+            if (E.file)
+                std::format_to(std::back_inserter(out), "Config error in file {}: {}", E.file, E.message);
+            else
+                std::format_to(std::back_inserter(out), "Config error: {}", E.message);
+        }
+    }
+
+    return out;
+}
+
+void SParseErrorList::clear() {
+    errors.clear();
+    strings.clear();
 }
 
 CConfigValue::~CConfigValue() {
-    if (m_pData) {
+    // arena payloads are freed with the arena
+    if (m_pData && !m_bArenaBacked) {
         switch (m_eType) {
             case CONFIGDATATYPE_INT: delete (int64_t*)m_pData; break;
             case CONFIGDATATYPE_FLOAT: delete (float*)m_pData; break;
@@ -76,42 +149,44 @@ CConfigCustomValueType::~CConfigCustomValueType() {
     dtor(&data);
 }
 
-void CConfigValue::defaultFrom(SConfigDefaultValue& ref) {
+void CConfigValue::defaultFrom(SConfigDefaultValue& ref, CValueArena* arena) {
     m_eType = (CConfigValue::eDataType)ref.type;
     switch (m_eType) {
         case CONFIGDATATYPE_FLOAT: {
-            if (!m_pData)
-                m_pData = new float;
-            *reinterpret_cast<float*>(m_pData) = std::any_cast<float>(ref.data);
+            if (!m_pData) {
+                m_pData        = arena ? arena->allocFloat() : new float;
+                m_bArenaBacked = arena;
+            }
+            *reinterpret_cast<float*>(m_pData) = std::get<FLOAT>(ref.data);
             break;
         }
         case CONFIGDATATYPE_INT: {
-            if (!m_pData)
-                m_pData = new int64_t;
-            *reinterpret_cast<int64_t*>(m_pData) = std::any_cast<int64_t>(ref.data);
+            if (!m_pData) {
+                m_pData        = arena ? arena->allocInt() : new int64_t;
+                m_bArenaBacked = arena;
+            }
+            *reinterpret_cast<int64_t*>(m_pData) = std::get<INT>(ref.data);
             break;
         }
         case CONFIGDATATYPE_STR: {
-            if (m_pData)
-                delete[] (char*)m_pData;
-            std::string str = std::any_cast<std::string>(ref.data);
-            m_pData         = new char[str.length() + 1];
-            strncpy((char*)m_pData, str.c_str(), str.length()); // TODO: please just wrap this
-            ((char*)m_pData)[str.length()] = '\0';
+            setString(std::get<std::string>(ref.data), arena);
             break;
         }
         case CONFIGDATATYPE_VEC2: {
-            if (!m_pData)
-                m_pData = new SVector2D;
-            *reinterpret_cast<SVector2D*>(m_pData) = std::any_cast<SVector2D>(ref.data);
+            if (!m_pData) {
+                m_pData        = arena ? arena->allocVec2() : new SVector2D;
+                m_bArenaBacked = arena;
+            }
+            *reinterpret_cast<SVector2D*>(m_pData) = std::get<SVector2D>(ref.data);
             break;
         }
         case CONFIGDATATYPE_CUSTOM: {
+            const auto& DEFAULT = std::get<std::string>(ref.data);
             if (!m_pData)
-                m_pData = new CConfigCustomValueType(ref.handler, ref.dtor, std::any_cast<std::string>(ref.data).c_str());
+                m_pData = new CConfigCustomValueType(ref.handler, ref.dtor, DEFAULT.c_str());
             CConfigCustomValueType* type = reinterpret_cast<CConfigCustomValueType*>(m_pData);
-            type->handler(std::any_cast<std::string>(ref.data).c_str(), &type->data);
-            type->lastVal = std::any_cast<std::string>(ref.data);
+            type->handler(DEFAULT.c_str(), &type->data);
+            type->lastVal = DEFAULT;
             break;
         }
         default: {
@@ -122,35 +197,65 @@ void CConfigValue::defaultFrom(SConfigDefaultValue& ref) {
     m_bSetByUser = false;
 }
 
-void CConfigValue::setFrom(const CConfigValue* const ref) {
+SConfigDefaultValue CConfigValue::asDefault() const {
     switch (m_eType) {
-        case CONFIGDATATYPE_FLOAT: {
-            if (!m_pData)
-                m_pData = new float;
-            *reinterpret_cast<float*>(m_pData) = std::any_cast<float>(ref->getValue());
-            break;
-        }
-        case CONFIGDATATYPE_INT: {
-            if (!m_pData)
-                m_pData = new int64_t;
-            *reinterpret_cast<int64_t*>(m_pData) = std::any_cast<int64_t>(ref->getValue());
-            break;
-        }
-        case CONFIGDATATYPE_STR: {
-            if (m_pData)
-                delete[] (char*)m_pData;
-            std::string str = std::any_cast<std::string>(ref->getValue());
-            m_pData         = new char[str.length() + 1];
-            strncpy((char*)m_pData, str.c_str(), str.length());
-            ((char*)m_pData)[str.length()] = '\0';
-            break;
-        }
-        case CONFIGDATATYPE_VEC2: {
-            if (!m_pData)
-                m_pData = new SVector2D;
-            *reinterpret_cast<SVector2D*>(m_pData) = std::any_cast<SVector2D>(ref->getValue());
-            break;
+        case CONFIGDATATYPE_INT: return SConfigDefaultValue{.data = *reinterpret_cast<INT*>(m_pData), .type = (::eDataType)m_eType};
+        case CONFIGDATATYPE_FLOAT: return SConfigDefaultValue{.data = *reinterpret_cast<FLOAT*>(m_pData), .type = (::eDataType)m_eType};
+        case CONFIGDATATYPE_STR: return SConfigDefaultValue{.data = std::string{reinterpret_cast<const char*>(m_pData)}, .type = (::eDataType)m_eType};
+        case CONFIGDATATYPE_VEC2: return SConfigDefaultValue{.data = *reinterpret_cast<SVector2D*>(m_pData), .type = (::eDataType)m_eType};
+        case CONFIGDATATYPE_CUSTOM: {
+            const auto TYPE = reinterpret_cast<CConfigCustomValueType*>(m_pData);
+            return SConfigDefaultValue{.data = TYPE->defaultVal, .type = (::eDataType)m_eType, .handler = TYPE->handler, .dtor = TYPE->dtor};
         }
+        default: break;
+    }
+
+    return SConfigDefaultValue{};
+}
+
+void CConfigValue::snapshot(SConfigDefaultValue& out) const {
+    out.type = (::eDataType)m_eType;
+
+    // assign into an existing string instead of replacing it, snapshots are taken on every parse()
+    auto setString = [&out](const char* str) {
+        if (auto* existing = std::get_if<std::string>(&out.data))
+            existing->assign(str);
+        else
+            out.data.emplace<std::string>(str);
+    };
+
+    switch (m_eType) {
+        case CONFIGDATATYPE_INT: out.data = *reinterpret_cast<INT*>(m_pData); break;
+        case CONFIGDATATYPE_FLOAT: out.data = *reinterpret_cast<FLOAT*>(m_pData); break;
+        case CONFIGDATATYPE_STR: setString(reinterpret_cast<const char*>(m_pData)); break;
+        case CONFIGDATATYPE_VEC2: out.data = *reinterpret_cast<SVector2D*>(m_pData); break;
+        case CONFIGDATATYPE_CUSTOM: setString(reinterpret_cast<CConfigCustomValueType*>(m_pData)->lastVal.c_str()); break;
+        default: out.data = std::monostate{}; break;
+    }
+}
+
+bool CConfigValue::sameAs(const SConfigDefaultValue& ref) const {
+    if ((::eDataType)m_eType != ref.type)
+        return false;
+
+    switch (m_eType) {
+        case CONFIGDATATYPE_INT: return std::get<INT>(ref.data) == *reinterpret_cast<INT*>(m_pData);
+        case CONFIGDATATYPE_FLOAT: return std::get<FLOAT>(ref.data) == *reinterpret_cast<FLOAT*>(m_pData);
+        case CONFIGDATATYPE_STR: return std::get<std::string>(ref.data) == reinterpret_cast<const char*>(m_pData);
+        case CONFIGDATATYPE_VEC2: return std::get<SVector2D>(ref.data) == *reinterpret_cast<SVector2D*>(m_pData);
+        case CONFIGDATATYPE_CUSTOM: return std::get<std::string>(ref.data) == reinterpret_cast<CConfigCustomValueType*>(m_pData)->lastVal;
+        default: break;
+    }
+
+    return true;
+}
+
+void CConfigValue::setFrom(const CConfigValue* const ref) {
+    switch (m_eType) {
+        case CONFIGDATATYPE_FLOAT: setFloat(*reinterpret_cast<FLOAT*>(ref->m_pData)); break;
+        case CONFIGDATATYPE_INT: setInt(*reinterpret_cast<INT*>(ref->m_pData)); break;
+        case CONFIGDATATYPE_STR: setString(reinterpret_cast<const char*>(ref->m_pData)); break;
+        case CONFIGDATATYPE_VEC2: setVec2(*reinterpret_cast<SVector2D*>(ref->m_pData)); break;
         case CONFIGDATATYPE_CUSTOM: {
             CConfigCustomValueType* reftype = reinterpret_cast<CConfigCustomValueType*>(ref->m_pData);
 
@@ -167,41 +272,75 @@ void CConfigValue::setFrom(const CConfigValue* const ref) {
     }
 }
 
-void CConfigValue::setFrom(std::any ref) {
+void CConfigValue::setInt(INT value) {
+    if (!m_pData)
+        m_pData = new INT;
+    *reinterpret_cast<INT*>(m_pData) = value;
+}
+
+void CConfigValue::setFloat(FLOAT value) {
+    if (!m_pData)
+        m_pData = new FLOAT;
+    *reinterpret_cast<FLOAT*>(m_pData) = value;
+}
+
+void CConfigValue::setVec2(const VEC2& value) {
+    if (!m_pData)
+        m_pData = new SVector2D;
+    *reinterpret_cast<SVector2D*>(m_pData) = value;
+}
+
+void CConfigValue::setString(std::string_view str, CValueArena* arena) {
+    // strings stay in the arena they already live in
+    if (!arena && m_bArenaBacked && m_pData)
+        arena = CValueArena::arenaOf((const char*)m_pData);
+
+    // overwrite in place when it fits. Every parse() resets strings to their default and sets them again.
+    if (m_bArenaBacked && m_pData && CValueArena::arenaOf((const char*)m_pData) == arena && str.length() < CValueArena::capacityOf((const char*)m_pData)) {
+        if (CValueArena::lengthOf((const char*)m_pData) == str.length() && std::memcmp(m_pData, str.data(), str.length()) == 0)
+            return;
+
+        std::memmove(m_pData, str.data(), str.length());
+        ((char*)m_pData)[str.length()] = '\0';
+        CValueArena::setLength((char*)m_pData, str.length());
+        return;
+    }
+
+    // allocate first, str may point into the old payload
+    char* data = arena ? arena->allocString(str.length()) : new char[str.length() + 1];
+    std::memcpy(data, str.data(), str.length());
+    data[str.length()] = '\0';
+
+    if (m_pData) {
+        if (m_bArenaBacked)
+            CValueArena::arenaOf((const char*)m_pData)->releaseString((char*)m_pData);
+        else
+            delete[] (char*)m_pData;
+    }
+
+    m_pData        = data;
+    m_bArenaBacked = arena;
+}
+
+void CConfigValue::assignFrom(const CConfigValue& other, CValueArena* arena) {
+    m_bSetByUser = other.m_bSetByUser;
+
     switch (m_eType) {
-        case CONFIGDATATYPE_FLOAT: {
-            if (!m_pData)
-                m_pData = new float;
-            *reinterpret_cast<float*>(m_pData) = std::any_cast<float>(ref);
-            break;
-        }
-        case CONFIGDATATYPE_INT: {
-            if (!m_pData)
-                m_pData = new int64_t;
-            *reinterpret_cast<int64_t*>(m_pData) = std::any_cast<int64_t>(ref);
-            break;
-        }
-        case CONFIGDATATYPE_STR: {
-            if (m_pData)
-                delete[] (char*)m_pData;
-            std::string str = std::any_cast<std::string>(ref);
-            m_pData         = new char[str.length() + 1];
-            strncpy((char*)m_pData, str.c_str(), str.length());
-            ((char*)m_pData)[str.length()] = '\0';
-            break;
-        }
-        case CONFIGDATATYPE_VEC2: {
-            if (!m_pData)
-                m_pData = new SVector2D;
-            *reinterpret_cast<SVector2D*>(m_pData) = std::any_cast<SVector2D>(ref);
-            break;
-        }
+        case CONFIGDATATYPE_INT: *reinterpret_cast<INT*>(m_pData) = *reinterpret_cast<INT*>(other.m_pData); break;
+        case CONFIGDATATYPE_FLOAT: *reinterpret_cast<FLOAT*>(m_pData) = *reinterpret_cast<FLOAT*>(other.m_pData); break;
+        case CONFIGDATATYPE_VEC2: *reinterpret_cast<SVector2D*>(m_pData) = *reinterpret_cast<SVector2D*>(other.m_pData); break;
+        case CONFIGDATATYPE_STR: setString(reinterpret_cast<const char*>(other.m_pData), arena); break;
         case CONFIGDATATYPE_CUSTOM: {
-            throw "bad defaultFrom type (cannot custom from std::any)";
+            // custom data can't be copied, so run the handler again. Only if needed, it may be expensive.
+            const auto TYPE = reinterpret_cast<CConfigCustomValueType*>(m_pData);
+            const auto REF  = reinterpret_cast<CConfigCustomValueType*>(other.m_pData);
+
+            if (TYPE->lastVal != REF->lastVal) {
+                TYPE->handler(REF->lastVal.c_str(), &TYPE->data);
+                TYPE->lastVal = REF->lastVal;
+            }
             break;
         }
-        default: {
-            throw "bad defaultFrom type";
-        }
+        default: break;
     }
 }
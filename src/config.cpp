@@ -1,17 +1,21 @@
 #include "config.hpp"
+#include "tokenizer.hpp"
+#include "numeric.hpp"
+#include "cache.hpp"
 #include <array>
-#include <exception>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
-#include <stdexcept>
 #include <string>
 #include <format>
 #include <algorithm>
 #include <cmath>
 #include <expected>
-#include <sstream>
 #include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <queue>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <hyprutils/string/VarList.hpp>
 #include <hyprutils/string/String.hpp>
 #include <hyprutils/string/ConstVarList.hpp>
@@ -19,17 +23,8 @@
 using namespace Hyprlang;
 using namespace Hyprutils::String;
 
-#ifdef __APPLE__
-#include <crt_externs.h>
-#define environ (*_NSGetEnviron())
-#else
-// NOLINTNEXTLINE
-extern "C" char** environ;
-#endif
-
 // defines
-inline constexpr const char* ANONYMOUS_KEY           = "__hyprlang_internal_anonymous_key";
-inline constexpr const char* MULTILINE_SPACE_CHARSET = " \t";
+inline constexpr const char* ANONYMOUS_KEY = "__hyprlang_internal_anonymous_key";
 //
 
 static size_t seekABIStructSize(const void* begin, size_t startOffset, size_t maxSize) {
@@ -41,43 +36,19 @@ static size_t seekABIStructSize(const void* begin, size_t startOffset, size_t ma
     return 0;
 }
 
-static SParsedConfigName parseConfigName(const char* name) {
-    const std::string NAME = name;
-    const auto        L    = NAME.find('[');
-    const auto        R    = NAME.find("]:", L);
+static SParsedConfigName parseConfigName(std::string_view name) {
+    const auto L = name.find('[');
+    const auto R = name.find("]:", L);
 
-    if (L != std::string::npos && R != std::string::npos)
+    if (L != std::string_view::npos && R != std::string_view::npos)
         return SParsedConfigName{
-            .category = NAME.substr(0, L),
-            .key      = NAME.substr(L + 1, R - L - 1),
-            .name     = NAME.substr(R + 2),
+            .category = name.substr(0, L),
+            .key      = name.substr(L + 1, R - L - 1),
+            .name     = name.substr(R + 2),
         };
     return SParsedConfigName{.name = name};
 }
 
-static std::expected<std::string, eGetNextLineFailure> getNextLine(std::istream& str, int& rawLineNum, int& lineNum) {
-    std::string line     = "";
-    std::string nextLine = "";
-
-    if (!std::getline(str, line))
-        return std::unexpected(GETNEXTLINEFAILURE_EOF);
-
-    lineNum = ++rawLineNum;
-
-    while (line.length() > 0 && line.at(line.length() - 1) == '\\') {
-        const auto lastNonSpace = line.length() < 2 ? -1 : line.find_last_not_of(MULTILINE_SPACE_CHARSET, line.length() - 2);
-        line                    = line.substr(0, lastNonSpace + 1);
-
-        if (!std::getline(str, nextLine))
-            return std::unexpected(GETNEXTLINEFAILURE_BACKSLASH);
-
-        ++rawLineNum;
-        line += nextLine;
-    }
-
-    return line;
-}
-
 CConfig::CConfig(const char* path, const Hyprlang::SConfigOptions& options_) : impl(new CConfigImpl) {
     SConfigOptions options;
     std::memcpy(&options, &options_, seekABIStructSize(&options_, 16, sizeof(SConfigOptions)));
@@ -92,14 +63,18 @@ CConfig::CConfig(const char* path, const Hyprlang::SConfigOptions& options_) : i
             throw "File does not exist";
     }
 
-    impl->recheckEnv();
-
-    std::ranges::sort(impl->envVariables, [&](const auto& a, const auto& b) { return a.name.length() > b.name.length(); });
-
     impl->configOptions = options;
 }
 
 CConfig::~CConfig() {
+    if (impl->pending && impl->pending->worker.joinable()) {
+        impl->staging->impl->cancelled = true;
+        impl->pending->worker.join();
+    }
+
+    if (impl->pendingFD >= 0)
+        close(impl->pendingFD);
+
     delete impl;
 }
 
@@ -107,53 +82,69 @@ void CConfig::addConfigValue(const char* name, const CConfigValue& value) {
     if (m_bCommenced)
         throw "Cannot addConfigValue after commence()";
 
-    if ((eDataType)value.m_eType != CONFIGDATATYPE_CUSTOM && (eDataType)value.m_eType != CONFIGDATATYPE_STR)
-        impl->defaultValues.emplace(name, SConfigDefaultValue{.data = value.getValue(), .type = (eDataType)value.m_eType});
-    else if ((eDataType)value.m_eType == CONFIGDATATYPE_STR)
-        impl->defaultValues.emplace(name, SConfigDefaultValue{.data = std::string{std::any_cast<const char*>(value.getValue())}, .type = (eDataType)value.m_eType});
-    else
-        impl->defaultValues.emplace(name,
-                                    SConfigDefaultValue{.data    = reinterpret_cast<CConfigCustomValueType*>(value.m_pData)->defaultVal,
-                                                        .type    = (eDataType)value.m_eType,
-                                                        .handler = reinterpret_cast<CConfigCustomValueType*>(value.m_pData)->handler,
-                                                        .dtor    = reinterpret_cast<CConfigCustomValueType*>(value.m_pData)->dtor});
+    if (!impl->defaultValues.contains(name))
+        impl->defaultValues.emplace(name, value.asDefault());
 }
 
 void CConfig::addSpecialConfigValue(const char* cat, const char* name, const CConfigValue& value) {
-    const auto IT = std::ranges::find_if(impl->specialCategoryDescriptors, [&](const auto& other) { return other->name == cat; });
+    const auto PDESC = impl->getDescriptor(cat);
 
-    if (IT == impl->specialCategoryDescriptors.end())
+    if (!PDESC)
         throw "No such category";
 
-    if ((eDataType)value.m_eType != CONFIGDATATYPE_CUSTOM && (eDataType)value.m_eType != CONFIGDATATYPE_STR)
-        IT->get()->defaultValues.emplace(name, SConfigDefaultValue{.data = value.getValue(), .type = (eDataType)value.m_eType});
-    else if ((eDataType)value.m_eType == CONFIGDATATYPE_STR)
-        IT->get()->defaultValues.emplace(name, SConfigDefaultValue{.data = std::string{std::any_cast<const char*>(value.getValue())}, .type = (eDataType)value.m_eType});
-    else
-        IT->get()->defaultValues.emplace(name,
-                                         SConfigDefaultValue{.data    = reinterpret_cast<CConfigCustomValueType*>(value.m_pData)->defaultVal,
-                                                             .type    = (eDataType)value.m_eType,
-                                                             .handler = reinterpret_cast<CConfigCustomValueType*>(value.m_pData)->handler,
-                                                             .dtor    = reinterpret_cast<CConfigCustomValueType*>(value.m_pData)->dtor});
+    // parsing adds the key of a category this way, only an actual addition changes anything
+    if (!PDESC->defaultValues.contains(name)) {
+        PDESC->defaultValues.emplace(name, value.asDefault());
+        impl->schemaChanged();
+
+        if (impl->staging)
+            impl->staging->addSpecialConfigValue(cat, name, value);
+    }
 
-    const auto CAT = std::ranges::find_if(impl->specialCategories, [cat](const auto& other) { return other->name == cat && other->isStatic; });
+    const auto INDEXIT = impl->specialCategoryIndex.find(std::string_view{cat});
 
-    if (CAT != impl->specialCategories.end())
-        CAT->get()->values[name].defaultFrom(IT->get()->defaultValues[name]);
+    if (INDEXIT != impl->specialCategoryIndex.end() && INDEXIT->second.staticCategory) {
+        INDEXIT->second.staticCategory->values[name].defaultFrom(PDESC->defaultValues[name], &impl->valueArena);
+        impl->specialCategoryGeneration++;
+        impl->snapshotStale = true;
+    }
 }
 
 void CConfig::removeSpecialConfigValue(const char* cat, const char* name) {
-    const auto IT = std::ranges::find_if(impl->specialCategoryDescriptors, [&](const auto& other) { return other->name == cat; });
+    const auto PDESC = impl->getDescriptor(cat);
 
-    if (IT == impl->specialCategoryDescriptors.end())
+    if (!PDESC)
         throw "No such category";
 
-    std::erase_if(IT->get()->defaultValues, [name](const auto& other) { return other.first == name; });
+    std::erase_if(PDESC->defaultValues, [name](const auto& other) { return other.first == name; });
 
-    for (auto& sc : impl->specialCategories) {
-        if (sc->descriptor->name == cat) {
-            std::erase_if(sc->values, [&](const auto& other) { return other.first == name; });
-        }
+    impl->specialCategoryGeneration++;
+    impl->snapshotStale = true;
+    impl->schemaChanged();
+
+    if (impl->staging)
+        impl->staging->removeSpecialConfigValue(cat, name);
+
+    const auto INDEXIT = impl->specialCategoryIndex.find(std::string_view{cat});
+
+    if (INDEXIT == impl->specialCategoryIndex.end())
+        return;
+
+    const auto removeFrom = [&](SSpecialCategory* sc) {
+        const auto IT = sc->values.find(std::string_view{name});
+
+        if (IT == sc->values.end())
+            return;
+
+        impl->valueArena.release(IT->second);
+        sc->values.erase(IT);
+    };
+
+    if (INDEXIT->second.staticCategory)
+        removeFrom(INDEXIT->second.staticCategory);
+
+    for (auto& sc : INDEXIT->second.keyed) {
+        removeFrom(sc);
     }
 }
 
@@ -161,80 +152,201 @@ void CConfig::addSpecialCategory(const char* name, SSpecialCategoryOptions optio
     SSpecialCategoryOptions options;
     std::memcpy(&options, &options_, seekABIStructSize(&options_, 8, sizeof(SSpecialCategoryOptions)));
 
+    impl->schemaChanged();
+
+    // in the same order, commitStaging() matches descriptors up by position
+    if (impl->staging)
+        impl->staging->addSpecialCategory(name, options);
+
     const auto PDESC          = impl->specialCategoryDescriptors.emplace_back(std::make_unique<SSpecialCategoryDescriptor>()).get();
     PDESC->name               = name;
     PDESC->key                = options.key ? options.key : "";
     PDESC->dontErrorOnMissing = options.ignoreMissing;
 
+    if (!impl->getDescriptor(name))
+        impl->descriptorTrie.insert(PDESC->name + ":", PDESC);
+
     if (!options.key && !options.anonymousKeyBased) {
         const auto PCAT  = impl->specialCategories.emplace_back(std::make_unique<SSpecialCategory>()).get();
         PCAT->descriptor = PDESC;
         PCAT->name       = name;
         PCAT->key        = "";
         PCAT->isStatic   = true;
+        impl->indexSpecialCategory(PCAT, "");
     }
 
     if (options.anonymousKeyBased) {
         PDESC->key       = ANONYMOUS_KEY;
         PDESC->anonymous = true;
     }
-
-    // sort longest to shortest
-    std::ranges::sort(impl->specialCategories, [](const auto& a, const auto& b) -> int { return a->name.length() > b->name.length(); });
-    std::ranges::sort(impl->specialCategoryDescriptors, [](const auto& a, const auto& b) -> int { return a->name.length() > b->name.length(); });
 }
 
 void CConfig::removeSpecialCategory(const char* name) {
+    impl->specialCategoryGeneration++;
+    impl->schemaChanged();
+
+    if (impl->staging)
+        impl->staging->removeSpecialCategory(name);
+
+    impl->specialCategoryIndex.erase(std::string{name});
+    impl->descriptorTrie.erase(std::string{name} + ":");
+
     std::erase_if(impl->specialCategories, [name](const auto& other) { return other->name == name; });
     std::erase_if(impl->specialCategoryDescriptors, [name](const auto& other) { return other->name == name; });
 }
 
+void CConfigImpl::schemaChanged() {
+    // the values don't only depend on the inputs anymore
+    lastInputs.reset();
+}
+
+SSpecialCategoryDescriptor* CConfigImpl::getDescriptor(std::string_view name) {
+    std::string withColon;
+    withColon.reserve(name.length() + 1);
+    withColon.append(name);
+    withColon += ':';
+
+    const auto PDESC = descriptorTrie.find(withColon);
+    return PDESC ? *PDESC : nullptr;
+}
+
+std::vector<SSpecialCategoryDescriptor*> CConfigImpl::descriptorsFor(std::string_view valueName) {
+    std::vector<SSpecialCategoryDescriptor*> found;
+    descriptorTrie.forEachPrefix(valueName, [&found](size_t, SSpecialCategoryDescriptor* desc) { found.emplace_back(desc); });
+
+    // longest to shortest, so that nested categories win over their parents
+    std::ranges::reverse(found);
+    return found;
+}
+
+SSpecialCategory* CConfigImpl::findSpecialCategory(std::string_view name, std::string_view key) {
+    const auto IT = specialCategoryIndex.find(name);
+
+    if (IT == specialCategoryIndex.end())
+        return nullptr;
+
+    if (IT->second.staticCategory)
+        return IT->second.staticCategory;
+
+    const auto KEYIT = IT->second.byKey.find(key);
+    return KEYIT == IT->second.byKey.end() ? nullptr : KEYIT->second;
+}
+
+// duplicate keys resolve to the oldest category, same as the front to back scan did before
+static void relinkSpecialCategoryKey(SSpecialCategoryIndex& index, const std::string& key) {
+    const auto IT = std::ranges::find_if(index.keyed, [&key](const auto& other) { return other->indexedKey == key; });
+
+    if (IT == index.keyed.end())
+        index.byKey.erase(key);
+    else
+        index.byKey[key] = *IT;
+}
+
+void CConfigImpl::indexSpecialCategory(SSpecialCategory* cat, std::string_view key) {
+    auto& index = specialCategoryIndex[cat->name];
+
+    specialCategoryGeneration++;
+
+    if (cat->isStatic) {
+        if (!index.staticCategory)
+            index.staticCategory = cat;
+        return;
+    }
+
+    cat->indexedKey = key;
+    index.keyed.emplace_back(cat);
+    index.byKey.try_emplace(cat->indexedKey, cat);
+}
+
+void CConfigImpl::reindexSpecialCategoryKey(SSpecialCategory* cat) {
+    if (cat->isStatic)
+        return;
+
+    const std::string KEY = (const char*)cat->values[cat->key].dataPtr();
+
+    if (KEY == cat->indexedKey)
+        return;
+
+    auto&      index  = specialCategoryIndex[cat->name];
+    const auto OLDKEY = std::exchange(cat->indexedKey, KEY);
+
+    specialCategoryGeneration++;
+
+    relinkSpecialCategoryKey(index, OLDKEY);
+    relinkSpecialCategoryKey(index, KEY);
+}
+
 void CConfig::applyDefaultsToCat(SSpecialCategory& cat) {
+    cat.arena = &impl->valueArena;
+
     for (auto& [k, v] : cat.descriptor->defaultValues) {
-        cat.values[k].defaultFrom(v);
+        cat.values[k].defaultFrom(v, cat.arena);
+    }
+}
+
+SSpecialCategory::~SSpecialCategory() {
+    if (!arena)
+        return;
+
+    // give the slots back, dynamic categories come and go with every parse
+    for (auto& [k, v] : values) {
+        arena->release(v);
     }
 }
 
 void CConfig::commence() {
     m_bCommenced = true;
     for (auto& [k, v] : impl->defaultValues) {
-        impl->values[k].defaultFrom(v);
+        impl->values[k].defaultFrom(v, &impl->valueArena);
     }
 }
 
-static std::expected<int64_t, std::string> configStringToInt(const std::string& VALUE) {
-    auto parseHex = [](const std::string& value) -> std::expected<int64_t, std::string> {
-        try {
-            size_t position;
-            auto   result = stoll(value, &position, 16);
-            if (position == value.size())
-                return result;
-        } catch (const std::exception&) {}
-        return std::unexpected("invalid hex " + value);
+// splits the inside of rgb()/rgba() on commas, the last channel gets the rest
+template <size_t N>
+static std::array<std::string_view, N> splitColorChannels(std::string_view str) {
+    std::array<std::string_view, N> channels;
+    for (size_t i = 0; i < N - 1; ++i) {
+        const auto COMMA = str.find(',');
+        channels[i]      = trimView(str.substr(0, COMMA));
+        str              = str.substr(COMMA + 1);
+    }
+    channels[N - 1] = trimView(str.substr(0, str.find(',')));
+    return channels;
+}
+
+static std::expected<int64_t, std::string> configStringToInt(std::string_view VALUE) {
+    auto parseHex = [](std::string_view value) -> std::expected<int64_t, std::string> {
+        // bare digits, which is what colors are, skip the generic path
+        if (const auto DIGITS = parseHexDigits(value); DIGITS.has_value())
+            return DIGITS.value();
+        const auto RESULT = parseHexInt(value);
+        if (RESULT.has_value())
+            return RESULT.value();
+        return std::unexpected("invalid hex " + std::string{value});
     };
     if (VALUE.starts_with("0x")) {
         // Values with 0x are hex
+        if (const auto DIGITS = parseHexDigits(VALUE.substr(2)); DIGITS.has_value())
+            return DIGITS.value();
         return parseHex(VALUE);
     } else if (VALUE.starts_with("rgba(") && VALUE.ends_with(')')) {
-        const auto VALUEWITHOUTFUNC = trim(VALUE.substr(5, VALUE.length() - 6));
+        const auto VALUEWITHOUTFUNC = trimView(VALUE.substr(5, VALUE.length() - 6));
 
         // try doing it the comma way first
         if (std::count(VALUEWITHOUTFUNC.begin(), VALUEWITHOUTFUNC.end(), ',') == 3) {
             // cool
-            std::string rolling = VALUEWITHOUTFUNC;
-            auto        r       = configStringToInt(trim(rolling.substr(0, rolling.find(','))));
-            rolling             = rolling.substr(rolling.find(',') + 1);
-            auto g              = configStringToInt(trim(rolling.substr(0, rolling.find(','))));
-            rolling             = rolling.substr(rolling.find(',') + 1);
-            auto b              = configStringToInt(trim(rolling.substr(0, rolling.find(','))));
-            rolling             = rolling.substr(rolling.find(',') + 1);
-            uint8_t a           = 0;
-            try {
-                a = std::round(std::stof(trim(rolling.substr(0, rolling.find(',')))) * 255.f);
-            } catch (std::exception& e) { return std::unexpected("failed parsing " + VALUEWITHOUTFUNC); }
+            const auto CHANNELS = splitColorChannels<4>(VALUEWITHOUTFUNC);
+            auto       r        = configStringToInt(CHANNELS[0]);
+            auto       g        = configStringToInt(CHANNELS[1]);
+            auto       b        = configStringToInt(CHANNELS[2]);
+            const auto A        = parseFloat(CHANNELS[3]);
+            if (!A.has_value())
+                return std::unexpected("failed parsing " + std::string{VALUEWITHOUTFUNC});
+
+            uint8_t a = std::round(A.value() * 255.f);
 
             if (!r.has_value() || !g.has_value() || !b.has_value())
-                return std::unexpected("failed parsing " + VALUEWITHOUTFUNC);
+                return std::unexpected("failed parsing " + std::string{VALUEWITHOUTFUNC});
 
             return (a * (Hyprlang::INT)0x1000000) + (r.value() * (Hyprlang::INT)0x10000) + (g.value() * (Hyprlang::INT)0x100) + b.value();
         } else if (VALUEWITHOUTFUNC.length() == 8) {
@@ -250,20 +362,18 @@ static std::expected<int64_t, std::string> configStringToInt(const std::string&
         return std::unexpected("rgba() expects length of 8 characters (4 bytes) or 4 comma separated values");
 
     } else if (VALUE.starts_with("rgb(") && VALUE.ends_with(')')) {
-        const auto VALUEWITHOUTFUNC = trim(VALUE.substr(4, VALUE.length() - 5));
+        const auto VALUEWITHOUTFUNC = trimView(VALUE.substr(4, VALUE.length() - 5));
 
         // try doing it the comma way first
         if (std::count(VALUEWITHOUTFUNC.begin(), VALUEWITHOUTFUNC.end(), ',') == 2) {
             // cool
-            std::string rolling = VALUEWITHOUTFUNC;
-            auto        r       = configStringToInt(trim(rolling.substr(0, rolling.find(','))));
-            rolling             = rolling.substr(rolling.find(',') + 1);
-            auto g              = configStringToInt(trim(rolling.substr(0, rolling.find(','))));
-            rolling             = rolling.substr(rolling.find(',') + 1);
-            auto b              = configStringToInt(trim(rolling.substr(0, rolling.find(','))));
+            const auto CHANNELS = splitColorChannels<3>(VALUEWITHOUTFUNC);
+            auto       r        = configStringToInt(CHANNELS[0]);
+            auto       g        = configStringToInt(CHANNELS[1]);
+            auto       b        = configStringToInt(CHANNELS[2]);
 
             if (!r.has_value() || !g.has_value() || !b.has_value())
-                return std::unexpected("failed parsing " + VALUEWITHOUTFUNC);
+                return std::unexpected("failed parsing " + std::string{VALUEWITHOUTFUNC});
 
             return (Hyprlang::INT)0xFF000000 + (r.value() * (Hyprlang::INT)0x10000) + (g.value() * (Hyprlang::INT)0x100) + b.value();
         } else if (VALUEWITHOUTFUNC.length() == 6) {
@@ -282,19 +392,19 @@ static std::expected<int64_t, std::string> configStringToInt(const std::string&
         return 0;
     }
 
-    if (VALUE.empty() || !isNumber(VALUE, false))
-        return std::unexpected("cannot parse \"" + VALUE + "\" as an int.");
+    const auto RES = parseInt(VALUE);
 
-    try {
-        const auto RES = std::stoll(VALUE);
-        return RES;
-    } catch (std::exception& e) { return std::unexpected(std::string{"stoll threw: "} + e.what()); }
+    if (!RES.has_value()) {
+        if (RES.error() == NUMERIC_OUT_OF_RANGE)
+            return std::unexpected("stoll threw: stoll");
+        return std::unexpected("cannot parse \"" + std::string{VALUE} + "\" as an int.");
+    }
 
-    return 0;
+    return RES.value();
 }
 
 // found, result
-std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& command, const std::string& value) {
+std::pair<bool, CParseResult> CConfig::configSetValueSafe(std::string_view command, std::string_view value) {
     CParseResult result;
 
     std::string  valueName;
@@ -307,97 +417,100 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
     // TODO: all this sucks xD
 
     SSpecialCategory* overrideSpecialCat = nullptr;
-    const auto        parsedName         = parseConfigName(valueName.c_str());
+    SSpecialCategory* targetCat          = nullptr; // category VALUEIT lives in, if any
+    SSpecialCategory* createdCat         = nullptr; // made by this call
+    const auto        parsedName         = parseConfigName(valueName);
 
-    if (!parsedName.category.empty()) {
-        impl->currentSpecialKey = parsedName.key;
-        valueName               = parsedName.category + ":" + parsedName.name;
+    // only runs for values that aren't plain ones
+    CStatsTimer specialTimer(impl->configOptions.collectStats, impl->stats.specialCategoryNs, false);
 
-        for (auto& sc : impl->specialCategoryDescriptors) {
-            if (sc->key.empty() || !valueName.starts_with(sc->name + ":"))
-                continue;
+    if (!parsedName.category.empty()) {
+        specialTimer.start();
 
-            bool keyExists = false;
-            for (const auto& specialCat : impl->specialCategories) {
-                if (specialCat->key != sc->key || specialCat->name != sc->name)
-                    continue;
+        // parsedName views into valueName, which gets rewritten
+        const std::string SPECIALKEY = std::string{parsedName.key};
 
-                if (parsedName.key != std::string_view{std::any_cast<const char*>(specialCat->values[sc->key].getValue())})
-                    continue;
+        impl->currentSpecialKey = SPECIALKEY;
+        valueName               = std::format("{}:{}", parsedName.category, parsedName.name);
 
-                // existing special
-                keyExists          = true;
-                overrideSpecialCat = specialCat.get();
-            }
+        for (const auto& sc : impl->descriptorsFor(valueName)) {
+            if (sc->key.empty())
+                continue;
 
-            if (keyExists)
+            // existing special
+            if (const auto PEXISTING = impl->findSpecialCategory(sc->name, SPECIALKEY); PEXISTING && PEXISTING->key == sc->key) {
+                overrideSpecialCat = PEXISTING;
                 break;
+            }
 
             // if it doesn't exist, make it
             const auto PCAT  = impl->specialCategories.emplace_back(std::make_unique<SSpecialCategory>()).get();
-            PCAT->descriptor = sc.get();
+            PCAT->descriptor = sc;
             PCAT->name       = sc->name;
             PCAT->key        = sc->key;
-            addSpecialConfigValue(sc->name.c_str(), sc->key.c_str(), CConfigValue(parsedName.key.c_str()));
+            addSpecialConfigValue(sc->name.c_str(), sc->key.c_str(), CConfigValue(SPECIALKEY.c_str()));
+            impl->countStat(&SParseStats::specialCategoriesCreated);
 
             applyDefaultsToCat(*PCAT);
 
-            PCAT->values[sc->key].setFrom(parsedName.key);
+            PCAT->values[sc->key].setString(SPECIALKEY);
+            impl->indexSpecialCategory(PCAT, SPECIALKEY);
             overrideSpecialCat = PCAT;
+            createdCat         = PCAT;
             break;
         }
     }
 
     auto VALUEIT = impl->values.find(valueName);
     if (VALUEIT == impl->values.end()) {
+        specialTimer.start();
+
         // it might be in a special category
         bool found = false;
 
         if (overrideSpecialCat) {
             VALUEIT = overrideSpecialCat->values.find(valueName.substr(overrideSpecialCat->name.length() + 1));
 
-            if (VALUEIT != overrideSpecialCat->values.end())
-                found = true;
+            if (VALUEIT != overrideSpecialCat->values.end()) {
+                found     = true;
+                targetCat = overrideSpecialCat;
+            }
         } else {
             if (impl->currentSpecialCategory && valueName.starts_with(impl->currentSpecialCategory->name)) {
                 VALUEIT = impl->currentSpecialCategory->values.find(valueName.substr(impl->currentSpecialCategory->name.length() + 1));
 
-                if (VALUEIT != impl->currentSpecialCategory->values.end())
-                    found = true;
+                if (VALUEIT != impl->currentSpecialCategory->values.end()) {
+                    found     = true;
+                    targetCat = impl->currentSpecialCategory;
+                }
             }
 
             // probably a handler
             if (!valueName.contains(":"))
                 return {false, result};
 
+            const auto DESCRIPTORS = impl->descriptorsFor(valueName);
+
             if (!found) {
-                for (auto& sc : impl->specialCategories) {
-                    if (!valueName.starts_with(sc->name + ":"))
-                        continue;
+                for (const auto& desc : DESCRIPTORS) {
+                    const auto FIELDNAME = std::string_view{valueName}.substr(desc->name.length() + 1);
 
-                    if (!sc->isStatic) {
-                        const auto fieldName        = valueName.substr(sc->name.length() + 1);
-                        const auto existingKeyValue = std::string{std::any_cast<const char*>(sc->values[sc->key].getValue())};
-
-                        // When parsing the key field itself, match by the value being set.
-                        // Otherwise, match by currentSpecialKey.
-                        // This ensures multiple blocks with different key values create separate categories,
-                        // and correctly handles empty string keys.
-                        if (fieldName == sc->key) {
-                            if (existingKeyValue != value)
-                                continue;
-                        } else {
-                            if (existingKeyValue != impl->currentSpecialKey)
-                                continue;
-                        }
-                    }
+                    // When parsing the key field itself, match by the value being set.
+                    // Otherwise, match by currentSpecialKey.
+                    // This ensures multiple blocks with different key values create separate categories,
+                    // and correctly handles empty string keys.
+                    const auto sc = impl->findSpecialCategory(desc->name, FIELDNAME == desc->key ? value : std::string_view{impl->currentSpecialKey});
+
+                    if (!sc)
+                        continue;
 
                     VALUEIT                      = sc->values.find(valueName.substr(sc->name.length() + 1));
-                    impl->currentSpecialCategory = sc.get();
+                    impl->currentSpecialCategory = sc;
 
-                    if (VALUEIT != sc->values.end())
-                        found = true;
-                    else if (sc->descriptor->dontErrorOnMissing)
+                    if (VALUEIT != sc->values.end()) {
+                        found     = true;
+                        targetCat = sc;
+                    } else if (sc->descriptor->dontErrorOnMissing)
                         return {false, result}; // will return a success, cuz we want to ignore missing
 
                     break;
@@ -406,8 +519,8 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
 
             if (!found) {
                 // could be a dynamic category that doesnt exist yet
-                for (auto& sc : impl->specialCategoryDescriptors) {
-                    if (sc->key.empty() || !valueName.starts_with(sc->name + ":"))
+                for (const auto& sc : DESCRIPTORS) {
+                    if (sc->key.empty())
                         continue;
 
                     // found value root to be a special category, get the trunk
@@ -419,18 +532,22 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
 
                     // bingo
                     const auto PCAT  = impl->specialCategories.emplace_back(std::make_unique<SSpecialCategory>()).get();
-                    PCAT->descriptor = sc.get();
+                    PCAT->descriptor = sc;
                     PCAT->name       = sc->name;
                     PCAT->key        = sc->key;
                     addSpecialConfigValue(sc->name.c_str(), sc->key.c_str(), CConfigValue("0"));
+                    impl->countStat(&SParseStats::specialCategoriesCreated);
 
                     applyDefaultsToCat(*PCAT);
 
                     VALUEIT                      = PCAT->values.find(valueName.substr(sc->name.length() + 1));
                     impl->currentSpecialCategory = PCAT;
+                    createdCat                   = PCAT;
 
-                    if (VALUEIT != PCAT->values.end())
-                        found = true;
+                    if (VALUEIT != PCAT->values.end()) {
+                        found     = true;
+                        targetCat = PCAT;
+                    }
 
                     if (sc->anonymous) {
                         // find suitable key
@@ -441,15 +558,19 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
 
                         biggest++;
 
-                        PCAT->values[ANONYMOUS_KEY].setFrom(std::to_string(biggest));
+                        PCAT->values[ANONYMOUS_KEY].setString(std::to_string(biggest));
                         impl->currentSpecialKey = std::to_string(biggest);
                         PCAT->anonymousID       = biggest;
+                        impl->indexSpecialCategory(PCAT, impl->currentSpecialKey);
                     } else {
                         if (VALUEIT == PCAT->values.end() || VALUEIT->first != sc->key) {
+                            impl->indexSpecialCategory(PCAT, (const char*)PCAT->values[sc->key].dataPtr());
                             result.setError(std::format("special category's first value must be the key. Key for <{}> is <{}>", PCAT->name, PCAT->key));
                             return {true, result};
                         }
                         impl->currentSpecialKey = value;
+                        // the key itself gets written below, index under it right away
+                        impl->indexSpecialCategory(PCAT, value);
                     }
 
                     break;
@@ -463,6 +584,13 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
         }
     }
 
+    specialTimer.stop();
+
+    // parse() diffs snapshots of everything instead
+    SConfigDefaultValue before;
+    if (impl->recordValueChanges)
+        VALUEIT->second.snapshot(before);
+
     switch (VALUEIT->second.m_eType) {
         case CConfigValue::eDataType::CONFIGDATATYPE_INT: {
 
@@ -472,44 +600,59 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
                 return {true, result};
             }
 
-            VALUEIT->second.setFrom(INT.value());
+            VALUEIT->second.setInt(INT.value());
 
             break;
         }
         case CConfigValue::eDataType::CONFIGDATATYPE_FLOAT: {
-            try {
-                VALUEIT->second.setFrom(std::stof(value));
-            } catch (std::exception& e) {
-                result.setError(std::format("failed parsing a float: {}", e.what()));
+            const auto FLOAT = parseFloat(value);
+            if (!FLOAT.has_value()) {
+                // keep the message stof used to produce
+                result.setError("failed parsing a float: stof");
                 return {true, result};
             }
+
+            VALUEIT->second.setFloat(FLOAT.value());
             break;
         }
         case CConfigValue::eDataType::CONFIGDATATYPE_VEC2: {
-            try {
-                const auto SPACEPOS = value.find(' ');
-                if (SPACEPOS == std::string::npos)
-                    throw std::runtime_error("no space");
-                const auto LHS = value.substr(0, SPACEPOS);
-                const auto RHS = value.substr(SPACEPOS + 1);
-
-                if (LHS.contains(" ") || RHS.contains(" "))
-                    throw std::runtime_error("too many args");
-
-                VALUEIT->second.setFrom(SVector2D{.x = std::stof(LHS), .y = std::stof(RHS)});
-            } catch (std::exception& e) {
-                result.setError(std::format("failed parsing a vec2: {}", e.what()));
+            const auto SPACEPOS = value.find(' ');
+            if (SPACEPOS == std::string::npos) {
+                result.setError("failed parsing a vec2: no space");
+                return {true, result};
+            }
+
+            const auto LHS = value.substr(0, SPACEPOS);
+            const auto RHS = value.substr(SPACEPOS + 1);
+
+            if (LHS.contains(' ') || RHS.contains(' ')) {
+                result.setError("failed parsing a vec2: too many args");
+                return {true, result};
+            }
+
+            const auto X = parseFloat(LHS);
+            const auto Y = parseFloat(RHS);
+
+            if (!X.has_value() || !Y.has_value()) {
+                result.setError("failed parsing a vec2: stof");
                 return {true, result};
             }
+
+            VALUEIT->second.setVec2(SVector2D{.x = X.value(), .y = Y.value()});
             break;
         }
         case CConfigValue::eDataType::CONFIGDATATYPE_STR: {
-            VALUEIT->second.setFrom(value);
+            VALUEIT->second.setString(value);
             break;
         }
         case CConfigValue::eDataType::CONFIGDATATYPE_CUSTOM: {
-            auto RESULT = reinterpret_cast<CConfigCustomValueType*>(VALUEIT->second.m_pData)
-                              ->handler(value.c_str(), &reinterpret_cast<CConfigCustomValueType*>(VALUEIT->second.m_pData)->data);
+            impl->countStat(&SParseStats::handlerCalls);
+            CStatsTimer        handlerTimer(impl->configOptions.collectStats, impl->stats.handlerNs);
+            CHandlerTimerScope handlerTimerScope(impl->handlerTimer, handlerTimer);
+            CTraceSpan         span(impl, TRACE_SPAN_CUSTOM_VALUE, VALUEIT->first.c_str());
+
+            auto               RESULT = reinterpret_cast<CConfigCustomValueType*>(VALUEIT->second.m_pData)
+                                     ->handler(std::string{value}.c_str(), &reinterpret_cast<CConfigCustomValueType*>(VALUEIT->second.m_pData)->data);
             reinterpret_cast<CConfigCustomValueType*>(VALUEIT->second.m_pData)->lastVal = value;
 
             if (RESULT.error) {
@@ -526,56 +669,211 @@ std::pair<bool, CParseResult> CConfig::configSetValueSafe(const std::string& com
 
     VALUEIT->second.m_bSetByUser = true;
 
+    if (targetCat && VALUEIT->first == targetCat->key)
+        impl->reindexSpecialCategoryKey(targetCat);
+
+    if (impl->recordValueChanges) {
+        if (createdCat)
+            impl->recordChange(CONFIG_CHANGE_SPECIAL_ADDED, "", createdCat->name, createdCat->indexedKey);
+        else if (!VALUEIT->second.sameAs(before)) {
+            auto& record  = impl->recordChange(targetCat ? CONFIG_CHANGE_SPECIAL_VALUE : CONFIG_CHANGE_VALUE, VALUEIT->first, targetCat ? targetCat->name : "",
+                                               targetCat && !targetCat->isStatic ? targetCat->indexedKey : "");
+            record.value  = &VALUEIT->second;
+            record.before = std::move(before);
+        }
+    }
+
     return {true, result};
 }
 
-CParseResult CConfig::parseVariable(const std::string& lhs, const std::string& rhs, bool dynamic) {
-    auto IT = std::ranges::find_if(impl->variables, [&](const auto& v) { return v.name == lhs.substr(1); });
+CParseResult CConfig::parseVariable(std::string_view lhs, std::string_view rhs, bool dynamic) {
+    const auto NAME = lhs.substr(1);
+    auto       IT   = impl->variables.find(NAME);
 
     if (IT != impl->variables.end())
-        IT->value = rhs;
+        IT->second.value = rhs;
     else {
-        impl->variables.push_back({lhs.substr(1), rhs});
-        std::ranges::sort(impl->variables, [](const auto& lhs, const auto& rhs) { return lhs.name.length() > rhs.name.length(); });
-        IT = std::ranges::find_if(impl->variables, [&](const auto& v) { return v.name == lhs.substr(1); });
+        IT = impl->variables.emplace(NAME, SVariable{.name = std::string{NAME}, .value = std::string{rhs}}).first;
+        impl->variableTrie.insert(NAME, &IT->second);
+
+        // shadowing an env variable, take over the lines that referenced it
+        if (const auto ENVIT = impl->envVariables.find(NAME); ENVIT != impl->envVariables.end() && ENVIT->second)
+            IT->second.linesContainingVar = std::move(ENVIT->second->linesContainingVar);
     }
 
-    if (dynamic) {
-        for (auto& l : IT->linesContainingVar) {
+    // lines re-evaluated below may set variables themselves, those are already part of the affected set
+    if (dynamic && !impl->reevaluatingVariables) {
+        impl->reevaluatingVariables = true;
+
+        for (const auto IDX : impl->linesAffectedBy(IT->second)) {
+            const auto& l                = impl->varLines[IDX];
             impl->categories             = l.categories;
             impl->currentSpecialCategory = l.specialCategory;
             parseLine(l.line, true);
         }
 
-        impl->categories = {};
+        impl->reevaluatingVariables = false;
+        impl->categories            = {};
     }
 
     CParseResult result;
     return result;
 }
 
-void CConfigImpl::recheckEnv() {
-    envVariables.clear();
-    for (char** env = environ; *env; ++env) {
-        const std::string ENVVAR   = *env ? *env : "";
-        const auto        VARIABLE = ENVVAR.substr(0, ENVVAR.find_first_of('='));
-        const auto        VALUE    = ENVVAR.substr(ENVVAR.find_first_of('=') + 1);
-        envVariables.push_back({VARIABLE, VALUE});
+std::vector<size_t> CConfigImpl::linesAffectedBy(const SVariable& var) {
+    // collect every line depending on var, directly or through variables defined from it
+    std::vector<size_t>           affected;
+    std::vector<bool>             seen(varLines.size(), false);
+    std::vector<const SVariable*> pending = {&var};
+
+    while (!pending.empty()) {
+        const auto V = pending.back();
+        pending.pop_back();
+
+        for (const auto IDX : V->linesContainingVar) {
+            if (seen[IDX])
+                continue;
+
+            seen[IDX] = true;
+            affected.emplace_back(IDX);
+
+            if (varLines[IDX].defines.empty())
+                continue;
+
+            if (const auto DEFINED = variables.find(varLines[IDX].defines); DEFINED != variables.end())
+                pending.emplace_back(&DEFINED->second);
+        }
     }
-}
 
-SVariable* CConfigImpl::getVariable(const std::string& name) {
-    for (auto& v : envVariables) {
-        if (v.name == name)
-            return &v;
+    // order them so that a line only runs after every affected line defining a variable it uses. Ties go by parse order.
+    std::unordered_map<size_t, size_t> indegree;
+    for (const auto IDX : affected) {
+        indegree.try_emplace(IDX, 0);
+
+        if (varLines[IDX].defines.empty())
+            continue;
+
+        if (const auto DEFINED = variables.find(varLines[IDX].defines); DEFINED != variables.end()) {
+            for (const auto DEP : DEFINED->second.linesContainingVar) {
+                indegree[DEP]++;
+            }
+        }
+    }
+
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<>> ready;
+    for (const auto& [IDX, DEG] : indegree) {
+        if (DEG == 0)
+            ready.push(IDX);
+    }
+
+    std::vector<size_t> ordered;
+    ordered.reserve(affected.size());
+
+    while (!ready.empty()) {
+        const auto IDX = ready.top();
+        ready.pop();
+        ordered.emplace_back(IDX);
+
+        if (varLines[IDX].defines.empty())
+            continue;
+
+        if (const auto DEFINED = variables.find(varLines[IDX].defines); DEFINED != variables.end()) {
+            for (const auto DEP : DEFINED->second.linesContainingVar) {
+                if (--indegree[DEP] == 0)
+                    ready.push(DEP);
+            }
+        }
     }
 
-    for (auto& v : variables) {
-        if (v.name == name)
-            return &v;
+    // self-referencing variables form cycles, those lines just go last in parse order
+    if (ordered.size() != affected.size()) {
+        std::ranges::sort(affected);
+        for (const auto IDX : affected) {
+            if (indegree[IDX] != 0)
+                ordered.emplace_back(IDX);
+        }
+    }
+
+    return ordered;
+}
+
+SVariable* CConfigImpl::getVariable(std::string_view name) {
+    if (const auto IT = variables.find(name); IT != variables.end())
+        return &IT->second;
+
+    return getEnvVariable(name);
+}
+
+SVariable* CConfigImpl::getEnvVariable(std::string_view name) {
+    auto IT = envVariables.find(name);
+
+    if (IT == envVariables.end()) {
+        std::string NAME  = std::string{name};
+        const auto  VALUE = getenv(NAME.c_str());
+        IT                = envVariables.emplace(NAME, VALUE ? std::optional<SVariable>{SVariable{.name = NAME, .value = VALUE}} : std::nullopt).first;
     }
 
-    return nullptr;
+    return IT->second ? &*IT->second : nullptr;
+}
+
+bool CConfigImpl::expandVariables(std::string_view in, std::string& out, std::vector<SVariable*>& used, size_t depth) {
+    // values are stored expanded, so recursing only happens for late-defined references. Limit it like the old 100-pass rescan.
+    if (depth >= 100)
+        return false;
+
+    countStat(&SParseStats::expansionIterations);
+
+    size_t pos = 0;
+    while (true) {
+        const auto DOLLAR = in.find('$', pos);
+
+        if (DOLLAR == std::string_view::npos) {
+            out.append(in.substr(pos));
+            return true;
+        }
+
+        out.append(in.substr(pos, DOLLAR - pos));
+
+        const auto NAMESTART = in.substr(DOLLAR + 1);
+        size_t     len       = 0;
+        SVariable* var       = nullptr;
+
+        if (const auto PVAR = variableTrie.longestPrefix(NAMESTART, &len); PVAR)
+            var = *PVAR;
+
+        // env variables only get looked up when referenced. A longer env name beats a config variable, same as it would in the trie.
+        size_t envLen = 0;
+        while (envLen < NAMESTART.length() && (std::isalnum((unsigned char)NAMESTART[envLen]) || NAMESTART[envLen] == '_')) {
+            ++envLen;
+        }
+
+        for (; envLen > (var ? len : 0); --envLen) {
+            if (const auto PENV = getEnvVariable(NAMESTART.substr(0, envLen)); PENV) {
+                var = PENV;
+                len = envLen;
+                break;
+            }
+        }
+
+        if (!var) {
+            out += '$';
+            pos = DOLLAR + 1;
+            continue;
+        }
+
+        if (std::ranges::find(used, var) == used.end())
+            used.emplace_back(var);
+
+        countStat(&SParseStats::variableSubstitutions);
+
+        if (var->value.contains('$')) {
+            if (!expandVariables(var->value, out, used, depth + 1))
+                return false;
+        } else
+            out += var->value;
+
+        pos = DOLLAR + 1 + len;
+    }
 }
 
 std::optional<std::string> CConfigImpl::parseComment(const std::string& comment) {
@@ -643,30 +941,34 @@ std::expected<float, std::string> CConfigImpl::parseExpression(const std::string
     if (args[1] != "+" && args[1] != "-" && args[1] != "*" && args[1] != "/")
         return std::unexpected("Invalid expression type: supported +, -, *, /");
 
-    auto  LHS_VAR = std::ranges::find_if(variables, [&](const auto& v) { return v.name == args[0]; });
-    auto  RHS_VAR = std::ranges::find_if(variables, [&](const auto& v) { return v.name == args[2]; });
+    const auto LHS_VAR = getVariable(args[0]);
+    const auto RHS_VAR = getVariable(args[2]);
 
     float left  = 0;
     float right = 0;
 
-    if (LHS_VAR != variables.end()) {
-        try {
-            left = std::stof(LHS_VAR->value);
-        } catch (...) { return std::unexpected("Failed to parse expression: value 1 holds a variable that does not look like a number"); }
+    if (LHS_VAR) {
+        const auto PARSED = parseFloat(LHS_VAR->value);
+        if (!PARSED.has_value())
+            return std::unexpected("Failed to parse expression: value 1 holds a variable that does not look like a number");
+        left = PARSED.value();
     } else {
-        try {
-            left = std::stof(std::string{args[0]});
-        } catch (...) { return std::unexpected("Failed to parse expression: value 1 does not look like a number or the variable doesn't exist"); }
+        const auto PARSED = parseFloat(args[0]);
+        if (!PARSED.has_value())
+            return std::unexpected("Failed to parse expression: value 1 does not look like a number or the variable doesn't exist");
+        left = PARSED.value();
     }
 
-    if (RHS_VAR != variables.end()) {
-        try {
-            right = std::stof(RHS_VAR->value);
-        } catch (...) { return std::unexpected("Failed to parse expression: value 1 holds a variable that does not look like a number"); }
+    if (RHS_VAR) {
+        const auto PARSED = parseFloat(RHS_VAR->value);
+        if (!PARSED.has_value())
+            return std::unexpected("Failed to parse expression: value 1 holds a variable that does not look like a number");
+        right = PARSED.value();
     } else {
-        try {
-            right = std::stof(std::string{args[2]});
-        } catch (...) { return std::unexpected("Failed to parse expression: value 1 does not look like a number or the variable doesn't exist"); }
+        const auto PARSED = parseFloat(args[2]);
+        if (!PARSED.has_value())
+            return std::unexpected("Failed to parse expression: value 1 does not look like a number or the variable doesn't exist");
+        right = PARSED.value();
     }
 
     switch (args[1][0]) {
@@ -680,504 +982,1970 @@ std::expected<float, std::string> CConfigImpl::parseExpression(const std::string
     return std::unexpected("Unknown error while parsing expression");
 }
 
-CParseResult CConfig::parseLine(std::string line, bool dynamic) {
-    CParseResult result;
+// we want to handle potentially nested keywords and ensure
+// we only call the handler if they are scoped correctly
+static bool handlerScopeMatches(const std::string& name, const std::vector<std::string>& categories, std::string_view lhs) {
+    const auto HANDLERNAME = std::string_view{name}.starts_with(':') ? std::string_view{name}.substr(1) : std::string_view{name};
+
+    size_t     colon = 0;
+    size_t     idx   = 0;
+    size_t     depth = 0;
+
+    while ((colon = HANDLERNAME.find(':', idx)) != std::string::npos && categories.size() > depth) {
+        auto actual = HANDLERNAME.substr(idx, colon - idx);
+
+        if (actual != categories[depth])
+            break;
+
+        idx = colon + 1;
+        ++depth;
+    }
+
+    return depth == categories.size() && HANDLERNAME.substr(idx) == lhs;
+}
 
-    line = trim(line);
+CParseResult CConfig::parseLine(std::string_view line, bool dynamic) {
+    CParseResult result;
 
-    auto commentPos = line.find('#');
+    std::string  scratch;
+    const auto   TOKENS = tokenizeLine(line, scratch);
 
-    if (commentPos == 0) {
-        const auto COMMENT_RESULT = impl->parseComment(line.substr(1));
+    if (TOKENS.type == LINETYPE_DIRECTIVE) {
+        const auto COMMENT_RESULT = impl->parseComment(std::string{TOKENS.comment});
         if (COMMENT_RESULT.has_value())
             result.setError(*COMMENT_RESULT);
         return result;
     }
 
+    if (TOKENS.type == LINETYPE_COMMENT)
+        return result;
+
     if (!impl->currentFlags.ifDatas.empty() && impl->currentFlags.ifDatas.back().failed)
         return result;
 
-    size_t lastHashPos = 0;
+    switch (TOKENS.type) {
+        case LINETYPE_EMPTY: return result;
+        case LINETYPE_INVALID: {
+            result.setError(TOKENS.error);
+            return result;
+        }
+        case LINETYPE_CATEGORY_CLOSE: {
+            if (impl->categories.empty()) {
+                result.setError("Stray category close");
+                return result;
+            }
+
+            impl->categories.pop_back();
 
-    while (commentPos != std::string::npos) {
-        bool escaped = false;
-        if (commentPos < line.length() - 1) {
-            if (line[commentPos + 1] == '#') {
-                lastHashPos = commentPos + 2;
-                escaped     = true;
+            if (impl->categories.empty()) {
+                impl->currentSpecialKey      = "";
+                impl->currentSpecialCategory = nullptr;
             }
-        }
 
-        if (!escaped) {
-            line = line.substr(0, commentPos);
-            break;
-        } else {
-            line       = line.substr(0, commentPos + 1) + line.substr(commentPos + 2);
-            commentPos = line.find('#', lastHashPos);
+            return result;
+        }
+        case LINETYPE_CATEGORY_OPEN: {
+            impl->categories.emplace_back(TOKENS.key);
+            return result;
         }
+        default: break;
     }
 
-    line = trim(line);
+    // set value or call handler
+    CParseResult     ret;
 
-    if (line.empty())
-        return result;
-
-    auto equalsPos = line.find('=');
+    const bool       ISVARIABLE = TOKENS.type == LINETYPE_VARIABLE;
 
-    if (equalsPos == std::string::npos && !line.ends_with("{") && line != "}") {
-        // invalid line
-        result.setError("Invalid config line");
-        return result;
-    }
+    std::string_view LHS = TOKENS.key;
+    std::string_view RHS = TOKENS.value;
 
-    if (equalsPos != std::string::npos) {
-        // set value or call handler
-        CParseResult ret;
-        auto         LHS = trim(line.substr(0, equalsPos));
-        auto         RHS = trim(line.substr(equalsPos + 1));
+    // only go through owned strings if something actually has to be rewritten
+    std::string ownedLHS, ownedRHS;
 
-        if (LHS.empty()) {
-            result.setError("Empty lhs.");
-            return result;
-        }
+    if ((!ISVARIABLE && LHS.contains('$')) || RHS.contains('$') || RHS.contains("{{")) {
+        std::vector<SVariable*> used;
 
-        const bool ISVARIABLE = *LHS.begin() == '$';
+        CStatsTimer             variableTimer(impl->configOptions.collectStats, impl->stats.variableNs);
 
-        // limit unwrapping iterations to 100. if exceeds, raise error
-        for (size_t i = 0; i < 100; ++i) {
-            bool anyMatch = false;
+        if (!ISVARIABLE && LHS.contains('$')) {
+            if (!impl->expandVariables(LHS, ownedLHS, used)) {
+                result.setError("Expanding variables exceeded max iteration limit");
+                return result;
+            }
+        } else
+            ownedLHS = LHS;
 
-            // parse variables
-            for (auto& var : impl->variables) {
-                // don't parse LHS variables if this is a variable...
-                const auto LHSIT = ISVARIABLE ? std::string::npos : LHS.find("$" + var.name);
-                const auto RHSIT = RHS.find("$" + var.name);
+        if (RHS.contains('$')) {
+            if (!impl->expandVariables(RHS, ownedRHS, used)) {
+                result.setError("Expanding variables exceeded max iteration limit");
+                return result;
+            }
+        } else
+            ownedRHS = RHS;
 
-                if (LHSIT != std::string::npos)
-                    replaceInString(LHS, "$" + var.name, var.value);
-                if (RHSIT != std::string::npos)
-                    replaceInString(RHS, "$" + var.name, var.value);
+        variableTimer.stop();
 
-                if (RHSIT == std::string::npos && LHSIT == std::string::npos)
-                    continue;
-                else if (!dynamic)
-                    var.linesContainingVar.push_back({line, impl->categories, impl->currentSpecialCategory});
+        if (!dynamic && !used.empty()) {
+            impl->varLines.push_back({std::string{line}, impl->categories, impl->currentSpecialCategory, ISVARIABLE ? std::string{LHS.substr(1)} : ""});
 
-                anyMatch = true;
+            for (const auto& var : used) {
+                var->linesContainingVar.emplace_back(impl->varLines.size() - 1);
             }
+        }
 
-            // parse expressions {{somevar + 2}}
-            // We only support single expressions for now
-            while (RHS.contains("{{")) {
-                auto firstUnescaped = RHS.find("{{");
-                // Keep searching until non-escaped expression start is found
-                while (firstUnescaped > 0) {
-                    // Special check to avoid undefined behaviour with std::basic_string::find_last_not_of
-                    auto amountSkipped = 0;
-                    for (int i = firstUnescaped - 1; i >= 0; i--) {
-                        if (RHS.at(i) != '\\')
-                            break;
-                        amountSkipped++;
-                    }
-                    // No escape chars, or even escape chars. means they escaped themselves.
-                    if (amountSkipped % 2 == 0)
-                        break;
-                    // Continue searching for next valid expression start.
-                    firstUnescaped = RHS.find("{{", firstUnescaped + 1);
-                    // Break if the next match is never found
-                    if (firstUnescaped == std::string::npos)
+        // parse expressions {{somevar + 2}}
+        // We only support single expressions for now
+        while (ownedRHS.contains("{{")) {
+            auto firstUnescaped = ownedRHS.find("{{");
+            // Keep searching until non-escaped expression start is found
+            while (firstUnescaped > 0) {
+                // Special check to avoid undefined behaviour with std::basic_string::find_last_not_of
+                auto amountSkipped = 0;
+                for (int i = firstUnescaped - 1; i >= 0; i--) {
+                    if (ownedRHS.at(i) != '\\')
                         break;
+                    amountSkipped++;
                 }
-                // Real match was never found.
-                if (firstUnescaped == std::string::npos)
+                // No escape chars, or even escape chars. means they escaped themselves.
+                if (amountSkipped % 2 == 0)
                     break;
-                const auto BEGIN_EXPR = firstUnescaped;
-                // "}}" doesnt need escaping. Would be invalid expression anyways.
-                const auto END_EXPR = RHS.find("}}", BEGIN_EXPR + 2);
-                if (END_EXPR != std::string::npos) {
-                    // try to parse the expression
-                    const auto RESULT = impl->parseExpression(RHS.substr(BEGIN_EXPR + 2, END_EXPR - BEGIN_EXPR - 2));
-                    if (!RESULT.has_value()) {
-                        result.setError(RESULT.error());
-                        return result;
-                    }
-
-                    RHS = RHS.substr(0, BEGIN_EXPR) + std::format("{}", RESULT.value()) + RHS.substr(END_EXPR + 2);
-                } else
+                // Continue searching for next valid expression start.
+                firstUnescaped = ownedRHS.find("{{", firstUnescaped + 1);
+                // Break if the next match is never found
+                if (firstUnescaped == std::string::npos)
                     break;
             }
-
-            if (!anyMatch)
+            // Real match was never found.
+            if (firstUnescaped == std::string::npos)
                 break;
+            const auto BEGIN_EXPR = firstUnescaped;
+            // "}}" doesnt need escaping. Would be invalid expression anyways.
+            const auto END_EXPR = ownedRHS.find("}}", BEGIN_EXPR + 2);
+            if (END_EXPR != std::string::npos) {
+                // try to parse the expression
+                impl->countStat(&SParseStats::expressionsEvaluated);
+                CStatsTimer expressionTimer(impl->configOptions.collectStats, impl->stats.expressionNs);
+                const auto  RESULT = impl->parseExpression(ownedRHS.substr(BEGIN_EXPR + 2, END_EXPR - BEGIN_EXPR - 2));
+                expressionTimer.stop();
+                if (!RESULT.has_value()) {
+                    result.setError(RESULT.error());
+                    return result;
+                }
 
-            if (i == 99) {
-                result.setError("Expanding variables exceeded max iteration limit");
-                return result;
-            }
+                ownedRHS = ownedRHS.substr(0, BEGIN_EXPR) + std::format("{}", RESULT.value()) + ownedRHS.substr(END_EXPR + 2);
+            } else
+                break;
         }
 
-        if (ISVARIABLE)
-            return parseVariable(LHS, RHS, dynamic);
+        LHS = ownedLHS;
+        RHS = ownedRHS;
+    }
+
+    if (ISVARIABLE)
+        return parseVariable(LHS, RHS, dynamic);
+
+    // Removing escape chars. -- in the future, maybe map all the chars that can be escaped.
+    // Right now only expression parsing has escapeable chars
+    if (RHS.contains('\\')) {
+        if (RHS.data() != ownedRHS.data())
+            ownedRHS = RHS;
 
-        // Removing escape chars. -- in the future, maybe map all the chars that can be escaped.
-        // Right now only expression parsing has escapeable chars
         const char                ESCAPE_CHAR = '\\';
         const std::array<char, 2> ESCAPE_SET{'{', '}'};
-        for (size_t i = 0; RHS.length() != 0 && i < RHS.length() - 1; i++) {
-            if (RHS.at(i) != ESCAPE_CHAR)
+        for (size_t i = 0; ownedRHS.length() != 0 && i < ownedRHS.length() - 1; i++) {
+            if (ownedRHS.at(i) != ESCAPE_CHAR)
                 continue;
             //if escaping an escape, remove and skip the next char
-            if (RHS.at(i + 1) == ESCAPE_CHAR) {
-                RHS.erase(i, 1);
+            if (ownedRHS.at(i + 1) == ESCAPE_CHAR) {
+                ownedRHS.erase(i, 1);
                 continue;
             }
             //checks if any of the chars were escapable.
             for (const auto& ESCAPABLE_CHAR : ESCAPE_SET) {
-                if (RHS.at(i + 1) != ESCAPABLE_CHAR)
+                if (ownedRHS.at(i + 1) != ESCAPABLE_CHAR)
                     continue;
-                RHS.erase(i--, 1);
+                ownedRHS.erase(i--, 1);
                 break;
             }
         }
 
-        bool found = false;
+        RHS = ownedRHS;
+    }
 
-        if (!impl->configOptions.verifyOnly) {
-            auto [f, rv]    = configSetValueSafe(LHS, RHS);
-            found           = f;
-            ret             = std::move(rv);
-            ret.errorString = ret.errorStdString.c_str();
-        }
+    if (impl->configOptions.builtinSource && LHS == "source")
+        return parseSource(RHS);
 
-        if (!found) {
-            for (auto& h : impl->handlers) {
-                // we want to handle potentially nested keywords and ensure
-                // we only call the handler if they are scoped correctly,
-                // unless the keyword is not scoped itself
+    bool found = false;
 
-                const bool UNSCOPED    = !h.name.contains(":");
-                const auto HANDLERNAME = !h.name.empty() && h.name.at(0) == ':' ? h.name.substr(1) : h.name;
+    if (!impl->configOptions.verifyOnly) {
+        auto [f, rv]    = configSetValueSafe(LHS, RHS);
+        found           = f;
+        ret             = std::move(rv);
+        ret.errorString = ret.errorStdString.c_str();
+    }
 
-                if (!h.options.allowFlags && !UNSCOPED) {
-                    size_t colon = 0;
-                    size_t idx   = 0;
-                    size_t depth = 0;
+    if (!found) {
+        std::vector<size_t> matches;
 
-                    while ((colon = HANDLERNAME.find(':', idx)) != std::string::npos && impl->categories.size() > depth) {
-                        auto actual = HANDLERNAME.substr(idx, colon - idx);
+        if (const auto IT = impl->handlerIndex.exact.find(LHS); IT != impl->handlerIndex.exact.end())
+            matches.insert(matches.end(), IT->second.begin(), IT->second.end());
 
-                        if (actual != impl->categories[depth])
-                            break;
+        // scoped keywords only match when nested exactly like the handler name says
+        if (!impl->handlerIndex.scoped.empty()) {
+            std::string path;
+            for (const auto& c : impl->categories) {
+                path += c + ':';
+            }
 
-                        idx = colon + 1;
-                        ++depth;
-                    }
+            path += LHS;
 
-                    if (depth != impl->categories.size() || HANDLERNAME.substr(idx) != LHS)
-                        continue;
+            if (const auto IT = impl->handlerIndex.scoped.find(path); IT != impl->handlerIndex.scoped.end()) {
+                for (const auto IDX : IT->second) {
+                    if (handlerScopeMatches(impl->handlers[IDX].name, impl->categories, LHS))
+                        matches.emplace_back(IDX);
                 }
+            }
+        }
 
-                if (UNSCOPED && HANDLERNAME != LHS && !h.options.allowFlags)
+        // avoid cases where a category is called the same as a handler
+        if (!LHS.contains(':'))
+            impl->handlerIndex.flags.forEachPrefix(LHS, [&matches](size_t, const std::vector<size_t>& idxs) { matches.insert(matches.end(), idxs.begin(), idxs.end()); });
+
+        if (!matches.empty()) {
+            // handlers run in registration order. Grab them all first, one might unregister another.
+            std::ranges::sort(matches);
+
+            std::vector<PCONFIGHANDLERFUNC> funcs;
+            std::vector<PCONFIGHANDLERFUNC> deferred; // for applyPending()
+            std::vector<std::string>        names;    // only needed for trace events
+            funcs.reserve(matches.size());
+            for (const auto IDX : matches) {
+                if (impl->deferMainThreadHandlers && impl->handlers[IDX].options.mainThreadOnly) {
+                    deferred.emplace_back(impl->handlers[IDX].func);
                     continue;
+                }
 
-                if (h.options.allowFlags && (!LHS.starts_with(HANDLERNAME) || LHS.contains(':') /* avoid cases where a category is called the same as a handler */))
-                    continue;
+                funcs.emplace_back(impl->handlers[IDX].func);
+                if (impl->traceFunc)
+                    names.emplace_back(impl->handlers[IDX].name);
+            }
+
+            const std::string COMMAND = std::string{LHS};
+            const std::string VALUE   = std::string{RHS};
+
+            // only ones from parsing files, not from parseDynamic()
+            if (!impl->cachePath.empty() && impl->rootFrame) {
+                for (const auto IDX : matches) {
+                    impl->handlerCalls.emplace_back(
+                        SHandlerCall{.handler = IDX, .command = COMMAND, .value = VALUE, .file = impl->currentFile ? impl->currentFile : "", .line = impl->currentLine});
+                }
+            }
+
+            for (const auto& func : deferred) {
+                impl->deferredHandlers.emplace_back(
+                    SDeferredHandler{.func = func, .command = COMMAND, .value = VALUE, .file = impl->currentFile ? impl->currentFile : "", .line = impl->currentLine});
+            }
+
+            impl->countStat(&SParseStats::handlerCalls, funcs.size());
+            CStatsTimer        handlerTimer(impl->configOptions.collectStats, impl->stats.handlerNs);
+            CHandlerTimerScope handlerTimerScope(impl->handlerTimer, handlerTimer);
+
+            for (size_t i = 0; i < funcs.size(); ++i) {
+                CTraceSpan span(impl, TRACE_SPAN_HANDLER, i < names.size() ? names[i].c_str() : "");
+                ret = funcs[i](COMMAND.c_str(), VALUE.c_str());
+            }
+
+            found = true;
+        }
+    }
+
+    if (ret.error)
+        return ret;
+
+    return result;
+}
+
+// the config whose staging config a thread is parsing into right now. Handlers calling back into the live one
+// are redirected there, so they see what earlier lines set, like with parse()
+static thread_local const CConfigImpl* parsingFor = nullptr;
+
+bool CConfigImpl::onParsingThread() const {
+    return parsingFor == this;
+}
+
+// marks this thread as parsing for impl, for as long as it lives
+// a parse outside of reparse() gets a list of its own, so results of earlier ones can keep pointing into theirs
+class CErrorCollection {
+  public:
+    CErrorCollection(CConfigImpl* impl) : m_pImpl(impl), m_bOutermost(!impl->collectingErrors) {
+        if (!m_bOutermost)
+            return;
+
+        if (impl->parseErrors.use_count() == 1)
+            impl->parseErrors->clear();
+        else
+            impl->parseErrors = std::make_shared<SParseErrorList>();
+
+        impl->collectingErrors = true;
+    }
+
+    ~CErrorCollection() {
+        if (m_bOutermost)
+            m_pImpl->collectingErrors = false;
+    }
+
+  private:
+    CConfigImpl* m_pImpl      = nullptr;
+    bool         m_bOutermost = false;
+};
+
+class CParsingGuard {
+  public:
+    CParsingGuard(const CConfigImpl* impl) : m_pPrev(std::exchange(parsingFor, impl)) {
+        ;
+    }
+
+    ~CParsingGuard() {
+        parsingFor = m_pPrev;
+    }
+
+  private:
+    const CConfigImpl* m_pPrev = nullptr;
+};
+
+CParseResult CConfig::parse() {
+    return parse(false);
+}
+
+CParseResult CConfig::parse(bool force) {
+    if (!m_bCommenced)
+        throw "Cannot parse: not commenced. You have to .commence() first.";
+
+    if (!force && impl->configOptions.skipUnchanged && impl->inputsUnchanged()) {
+        cancelParse();
+        impl->changeRecords.clear();
+        impl->publishChanges();
+
+        return impl->lastInputs->result;
+    }
+
+    // once values came from somewhere, a cache would only be a slower way to parse
+    if (!force && !impl->committedAParse && !impl->cachePath.empty()) {
+        if (auto result = loadCache(); result)
+            return *result;
+    }
+
+    cancelParse();
+
+    // straight into the values, so handlers see what earlier lines set and can keep pointers to values
+    impl->snapshotForChanges();
+
+    CParseResult result;
+
+    try {
+        result = reparse();
+    } catch (...) {
+        abortReparse();
+        throw;
+    }
+
+    impl->keepInputs();
+    return finishParse(std::move(result), false);
+}
+
+// eventfd reads and writes are all or nothing, so only an interrupt is worth retrying
+static void signalPendingFD(int fd) {
+    const uint64_t ONE = 1;
+
+    // if this still fails, only pollers miss the parse, the future is ready either way
+    while (write(fd, &ONE, sizeof(ONE)) < 0 && errno == EINTR) {
+        ;
+    }
+}
+
+static void drainPendingFD(int fd) {
+    uint64_t drained = 0;
+
+    // EAGAIN means there was nothing to drain
+    while (read(fd, &drained, sizeof(drained)) < 0 && errno == EINTR) {
+        ;
+    }
+}
+
+std::future<void> CConfig::parseAsync() {
+    beginPending();
+    impl->staging->impl->deferMainThreadHandlers = true;
+
+    if (impl->pendingFD < 0)
+        impl->pendingFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    auto future           = impl->pending->done.get_future();
+    impl->pending->worker = std::thread([this] {
+        try {
+            runPending();
+        } catch (...) { impl->pending->exception = std::current_exception(); }
+
+        impl->pending->done.set_value();
+
+        if (impl->pendingFD >= 0)
+            signalPendingFD(impl->pendingFD);
+    });
+
+    return future;
+}
+
+int CConfig::getPendingFD() const {
+    return impl->pendingFD;
+}
+
+void CConfig::beginParse() {
+    beginPending();
+    impl->pending->stepping                      = true;
+    impl->staging->impl->deferMainThreadHandlers = false;
+
+    try {
+        CParsingGuard guard(impl);
+        impl->staging->beginReparse();
+    } catch (...) {
+        cancelParse();
+        throw;
+    }
+}
+
+std::optional<CParseResult> CConfig::step(const SParseBudget& budget_) {
+    if (!impl->pending || !impl->pending->stepping)
+        throw "Cannot step: nothing to step. Call beginParse() first.";
+
+    SParseBudget budget;
+    std::memcpy(&budget, &budget_, seekABIStructSize(&budget_, 16, sizeof(SParseBudget)));
+
+    try {
+        CParsingGuard guard(impl);
+        if (!impl->staging->continueReparse(budget))
+            return std::nullopt;
+    } catch (...) {
+        cancelParse();
+        throw;
+    }
+
+    impl->pending->result   = std::move(impl->staging->impl->reparseResult);
+    impl->pending->stepping = false;
+    return applyPending();
+}
+
+void CConfig::cancelParse() {
+    if (!impl->pending)
+        return;
+
+    const auto STAGING = impl->staging->impl;
+    STAGING->cancelled = true;
+
+    if (impl->pending->worker.joinable()) {
+        impl->pending->worker.join();
+        drainPendingFD(impl->pendingFD);
+    }
+
+    impl->staging->abortReparse();
+    STAGING->cancelled = false;
+    impl->pending.reset();
+}
+
+void CConfig::beginPending() {
+    if (!m_bCommenced)
+        throw "Cannot parse: not commenced. You have to .commence() first.";
+
+    cancelParse();
+    prepareStaging();
+    impl->pending = std::make_unique<SPendingParse>();
+
+    const auto STAGING       = impl->staging->impl;
+    STAGING->path            = impl->path;
+    STAGING->rawConfigString = impl->rawConfigString;
+    STAGING->traceFunc       = impl->traceFunc;
+    STAGING->traceData       = impl->traceData;
+    STAGING->cachePath       = impl->cachePath;
+    STAGING->deferredHandlers.clear();
+}
+
+void CConfig::runPending() {
+    CParsingGuard guard(impl);
+    impl->pending->result = impl->staging->reparse();
+}
+
+CParseResult CConfig::applyPending() {
+    if (!impl->pending)
+        throw "Cannot apply: nothing is pending. Call parseAsync() first.";
+
+    if (impl->pending->stepping)
+        throw "Cannot apply: a parse from beginParse() is applied by its last step().";
+
+    const auto PENDING = std::move(impl->pending);
+
+    if (PENDING->worker.joinable()) {
+        PENDING->worker.join();
+        drainPendingFD(impl->pendingFD);
+    }
+
+    if (PENDING->exception)
+        std::rethrow_exception(PENDING->exception);
+
+    auto result = std::move(PENDING->result);
+
+    impl->snapshotForChanges();
+
+    commitStaging();
+
+    // values are all in place by now, so these see the whole config
+    const auto DEFERRED   = std::move(impl->staging->impl->deferredHandlers);
+    size_t     errorsSeen = 0;
+
+    for (const auto& d : DEFERRED) {
+        const auto ERRORSBEFORE = impl->parseErrors->errors.size();
+        const auto RET          = d.func(d.command.c_str(), d.value.c_str());
+
+        if (RET.error && impl->parseErrors->errors.size() > ERRORSBEFORE) {
+            // from a parseFile() it ran, already listed
+            errorsSeen = impl->parseErrors->errors.size();
+        } else if (RET.error && (impl->parseErrors->errors.empty() || impl->configOptions.throwAllErrors)) {
+            impl->parseErrors->add(PARSE_ERROR_STATEMENT, d.file.empty() ? nullptr : d.file.c_str(), d.line, 1, RET.errorStdString);
+            errorsSeen = impl->parseErrors->errors.size();
+        }
+    }
+
+    // results with just a message, e.g. a missing file, keep it
+    if (errorsSeen && (!result.error || result.errorList == impl->parseErrors))
+        result.setErrors(impl->parseErrors, errorsSeen);
+
+    return finishParse(std::move(result), PENDING->fromCache);
+}
+
+// what every parse does once the values are in place, wherever they came from
+CParseResult CConfig::finishParse(CParseResult result, bool fromCache) {
+    impl->committedAParse  = true;
+    impl->collectingErrors = false;
+
+    if (impl->lastInputs)
+        impl->lastInputs->result = result;
+
+    if (!fromCache && !impl->cachePath.empty() && !result.error)
+        writeCache();
+
+    // even without a file, values went back to their defaults
+    impl->collectChanges();
+
+    if (impl->configOptions.publishSnapshots)
+        impl->publishSnapshot();
+
+    // last, so listeners see the whole config
+    impl->deliverChanges();
+
+    return result;
+}
+
+// the parse itself: back to defaults, then everything from the top, straight into this config
+CParseResult CConfig::reparse() {
+    beginReparse();
+    continueReparse({});
+    return std::move(impl->reparseResult);
+}
+
+void CConfig::beginReparse() {
+    impl->stats = {};
+    CStatsTimer totalTimer(impl->configOptions.collectStats, impl->stats.totalNs);
+    impl->parseSpan.emplace(impl, TRACE_SPAN_PARSE, "parse");
+
+    resetToDefaults();
+
+    impl->reparseResult  = {};
+    impl->recordedInputs = {.root = impl->path};
+    impl->handlerCalls.clear();
+    impl->replayable = true;
+    impl->rootFrame  = std::make_unique<SParseFrame>();
+    impl->sourceFrames.clear();
+
+    impl->rootFrame->resumable = true;
+    impl->rootFrame->started   = true;
+
+    if (impl->rawConfigString.empty()) {
+        bool fileExists = std::filesystem::exists(impl->path);
+
+        // a missing file with options.allowMissingConfig leaves everything at its default
+        if (!fileExists) {
+            if (!impl->configOptions.allowMissingConfig)
+                impl->reparseResult.setError("Config file is missing");
+            // so it's noticed when it appears
+            impl->recordedInputs.files.emplace_back(SParseInput{.path = impl->path});
+            impl->rootFrame.reset();
+        } else {
+            std::string canonical = std::filesystem::canonical(impl->path);
+
+            if (!openFrame(*impl->rootFrame, canonical.c_str())) {
+                impl->reparseResult.setError("File failed to open");
+                impl->rootFrame.reset();
+            } else
+                impl->sourceStack = {canonical};
+        }
+    } else {
+        impl->rootFrame->reader.emplace(impl->rawConfigString);
+        impl->countStat(&SParseStats::bytesRead, impl->rawConfigString.length());
+    }
+}
+
+void CConfig::resetToDefaults() {
+    clearState();
+
+    for (auto& [k, v] : impl->defaultValues) {
+        impl->values.at(k).defaultFrom(v, &impl->valueArena);
+    }
+    for (auto& sc : impl->specialCategories) {
+        applyDefaultsToCat(*sc);
+    }
+}
+
+SParseStep::SParseStep(const SParseBudget& budget) : maxLines(budget.lines) {
+    if (budget.ns)
+        deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(budget.ns);
+}
+
+bool SParseStep::exhausted() const {
+    return lines > 0 && ((maxLines && lines >= maxLines) || (deadline && std::chrono::steady_clock::now() >= *deadline));
+}
+
+// true once everything is parsed
+bool CConfig::continueReparse(const SParseBudget& budget) {
+    CStatsTimer totalTimer(impl->configOptions.collectStats, impl->stats.totalNs);
+    SParseStep  step(budget);
+
+    while (impl->rootFrame) {
+        auto& frame = impl->sourceFrames.empty() ? *impl->rootFrame : *impl->sourceFrames.back();
+
+        if (!frame.started) {
+            frame.started = true;
+            frame.span.emplace(impl, TRACE_SPAN_FILE, frame.file.c_str());
+            impl->sourceStack.emplace_back(frame.file);
+        }
+
+        if (!parseFrame(frame, &step)) {
+            // a source line left its files on top, they go first
+            if (!impl->sourceFrames.empty() && !impl->sourceFrames.back()->started)
+                continue;
+
+            return false;
+        }
+
+        if (impl->sourceFrames.empty()) {
+            impl->reparseResult = finishFrame(*impl->rootFrame);
+            impl->rootFrame.reset();
+            break;
+        }
+
+        // its errors are already in the list, the frame below picks them up from there
+        closeFrame(frame);
+        const auto ERRORSSEEN = frame.errorsSeen;
+        impl->sourceFrames.pop_back();
+        impl->sourceStack.pop_back();
+
+        auto& below      = impl->sourceFrames.empty() ? *impl->rootFrame : *impl->sourceFrames.back();
+        below.errorsSeen = std::max(below.errorsSeen, ERRORSSEEN);
+    }
+
+    if (impl->prefetching)
+        impl->prefetcher->stop();
+
+    impl->prefetching = false;
+    impl->sourceStack.clear();
+    impl->parseSpan.reset();
+    return true;
+}
+
+void CConfig::abortReparse() {
+    // the state it leaves behind is cleared by the next beginReparse()
+    impl->sourceFrames.clear();
+    impl->rootFrame.reset();
+
+    if (impl->prefetching)
+        impl->prefetcher->stop();
+
+    impl->prefetching = false;
+    impl->sourceStack.clear();
+    impl->parseSpan.reset();
+    impl->categories.clear();
+    impl->currentSpecialCategory = nullptr;
+    impl->collectingErrors       = false;
+}
+
+// a second config with the same values, special categories and handlers, nothing parsed yet
+void CConfig::prepareStaging() {
+    if (impl->staging)
+        return;
+
+    SConfigOptions options   = impl->configOptions;
+    options.pathIsStream     = true; // skips the file check, runPending() hands over the path
+    options.publishSnapshots = false;
+
+    impl->staging          = std::make_unique<CConfig>("", options);
+    const auto STAGING     = impl->staging->impl;
+    STAGING->defaultValues = impl->defaultValues;
+    STAGING->handlers      = impl->handlers;
+    STAGING->rebuildHandlerIndex();
+
+    // in the same order, commitStaging() matches them up by position
+    for (const auto& desc : impl->specialCategoryDescriptors) {
+        const auto PDESC = STAGING->specialCategoryDescriptors.emplace_back(std::make_unique<SSpecialCategoryDescriptor>(*desc)).get();
+
+        if (!STAGING->getDescriptor(PDESC->name))
+            STAGING->descriptorTrie.insert(PDESC->name + ":", PDESC);
+    }
+
+    for (const auto& sc : impl->specialCategories) {
+        if (!sc->isStatic)
+            continue;
+
+        const auto DESCIDX = std::ranges::find_if(impl->specialCategoryDescriptors, [&sc](const auto& d) { return d.get() == sc->descriptor; }) - impl->specialCategoryDescriptors.begin();
+
+        const auto PCAT  = STAGING->specialCategories.emplace_back(std::make_unique<SSpecialCategory>()).get();
+        PCAT->descriptor = STAGING->specialCategoryDescriptors[DESCIDX].get();
+        PCAT->name       = sc->name;
+        PCAT->isStatic   = true;
+        STAGING->indexSpecialCategory(PCAT, "");
+    }
+
+    impl->staging->commence();
+}
+
+// copies everything the staging config parsed into this one. Value pointers handed out stay the same.
+void CConfig::commitStaging() {
+    const auto STAGING = impl->staging->impl;
+
+    clearState();
+
+    for (const auto& [name, value] : STAGING->values) {
+        if (const auto IT = impl->values.find(name); IT != impl->values.end())
+            IT->second.assignFrom(value, &impl->valueArena);
+    }
+
+    // parsing adds the key of a special category to its defaults when first seen
+    for (size_t i = 0; i < impl->specialCategoryDescriptors.size(); ++i) {
+        for (const auto& [name, value] : STAGING->specialCategoryDescriptors[i]->defaultValues) {
+            impl->specialCategoryDescriptors[i]->defaultValues.try_emplace(name, value);
+        }
+    }
+
+    std::unordered_map<const SSpecialCategory*, SSpecialCategory*> committed; // staging category -> ours
+
+    for (const auto& sc : STAGING->specialCategories) {
+        SSpecialCategory* target = nullptr;
+
+        if (sc->isStatic) {
+            const auto IT = impl->specialCategoryIndex.find(sc->name);
+            target        = IT == impl->specialCategoryIndex.end() ? nullptr : IT->second.staticCategory;
+        } else {
+            const auto DESCIDX =
+                std::ranges::find_if(STAGING->specialCategoryDescriptors, [&sc](const auto& d) { return d.get() == sc->descriptor; }) - STAGING->specialCategoryDescriptors.begin();
+
+            target              = impl->specialCategories.emplace_back(std::make_unique<SSpecialCategory>()).get();
+            target->descriptor  = impl->specialCategoryDescriptors[DESCIDX].get();
+            target->name        = sc->name;
+            target->key         = sc->key;
+            target->anonymousID = sc->anonymousID;
+            applyDefaultsToCat(*target);
+        }
+
+        if (!target)
+            continue;
+
+        for (const auto& [name, value] : sc->values) {
+            if (const auto IT = target->values.find(name); IT != target->values.end())
+                IT->second.assignFrom(value, target->arena);
+        }
+
+        if (!sc->isStatic)
+            impl->indexSpecialCategory(target, sc->indexedKey);
+
+        committed[sc.get()] = target;
+    }
+
+    // swapped, not moved, so the staging config stays usable
+    std::swap(impl->variables, STAGING->variables);
+    std::swap(impl->variableTrie, STAGING->variableTrie);
+    std::swap(impl->envVariables, STAGING->envVariables);
+    std::swap(impl->varLines, STAGING->varLines);
+
+    for (auto& line : impl->varLines) {
+        if (line.specialCategory)
+            line.specialCategory = committed.contains(line.specialCategory) ? committed.at(line.specialCategory) : nullptr;
+    }
+
+    impl->parseErrors = STAGING->parseErrors;
+    impl->stats       = STAGING->stats;
+
+    impl->recordedInputs = std::move(STAGING->recordedInputs);
+    impl->handlerCalls   = std::move(STAGING->handlerCalls);
+    impl->replayable     = STAGING->replayable;
+    impl->keepInputs();
+}
+
+void CConfig::changeRootPath(const char* path) {
+    impl->path = path;
+}
+
+const SParseStats& CConfig::getParseStats() const {
+    return impl->stats;
+}
+
+std::span<const SConfigChange> CConfig::getChanges() const {
+    return impl->changes;
+}
+
+SChangeRecord& CConfigImpl::recordChange(eConfigChangeType type, std::string_view name, std::string_view category, std::string_view key) {
+    return changeRecords.emplace_back(SChangeRecord{.type = type, .name = std::string{name}, .category = std::string{category}, .key = std::string{key}});
+}
+
+void CConfigImpl::publishChanges() {
+    changes.clear();
+    changes.reserve(changeRecords.size());
+    for (const auto& r : changeRecords) {
+        changes.emplace_back(SConfigChange{.type = r.type, .name = r.name.c_str(), .category = r.category.c_str(), .key = r.key.c_str()});
+    }
+}
+
+static std::any anyFromSnapshot(const SConfigDefaultValue& value) {
+    switch (value.type) {
+        case CONFIGDATATYPE_INT: return std::get<INT>(value.data);
+        case CONFIGDATATYPE_FLOAT: return std::get<FLOAT>(value.data);
+        case CONFIGDATATYPE_STR: return (STRING)std::get<std::string>(value.data).c_str();
+        case CONFIGDATATYPE_VEC2: return std::get<SVector2D>(value.data);
+        default: break;
+    }
+
+    return {};
+}
+
+static bool changeMatches(std::string_view pattern, const SChangeRecord& record, std::string_view fullName) {
+    if (pattern.ends_with('*'))
+        return fullName.starts_with(pattern.substr(0, pattern.length() - 1));
+
+    return pattern == fullName || (!record.category.empty() && pattern == record.category);
+}
+
+void CConfigImpl::deliverChanges() {
+    if (changeListeners.empty() || changeRecords.empty())
+        return;
+
+    // listeners may parse again or remove listeners, work on copies
+    const auto                      LISTENERS = changeListeners;
+    const auto                      RECORDS   = changeRecords;
+
+    std::vector<SConfigChange>      views;
+    std::vector<std::string>        fullNames;
+    std::vector<SConfigValueChange> all;
+    views.reserve(RECORDS.size());
+    fullNames.reserve(RECORDS.size());
+    all.reserve(RECORDS.size());
+
+    for (const auto& r : RECORDS) {
+        views.emplace_back(SConfigChange{.type = r.type, .name = r.name.c_str(), .category = r.category.c_str(), .key = r.key.c_str()});
+
+        switch (r.type) {
+            case CONFIG_CHANGE_VALUE: fullNames.emplace_back(r.name); break;
+            case CONFIG_CHANGE_SPECIAL_VALUE: fullNames.emplace_back(r.category + ":" + r.name); break;
+            default: fullNames.emplace_back(r.category); break;
+        }
+    }
+
+    // strings are copied like before, a listener that parses again may move or free them
+    std::deque<std::string> afterStrings;
+
+    for (size_t i = 0; i < RECORDS.size(); ++i) {
+        auto after = RECORDS[i].value ? RECORDS[i].value->getValue() : std::any{};
+        if (const auto STR = std::any_cast<const char*>(&after))
+            after = afterStrings.emplace_back(*STR).c_str();
+
+        all.emplace_back(SConfigValueChange{.change = &views[i], .before = anyFromSnapshot(RECORDS[i].before), .after = std::move(after)});
+    }
+
+    std::vector<SConfigValueChange> matched;
+    for (const auto& l : LISTENERS) {
+        matched.clear();
+
+        for (size_t i = 0; i < RECORDS.size(); ++i) {
+            if (changeMatches(l.pattern, RECORDS[i], fullNames[i]))
+                matched.emplace_back(all[i]);
+        }
+
+        if (!matched.empty())
+            l.func(matched, l.data);
+    }
+}
+
+void CConfig::addChangeListener(const char* pattern, PCONFIGCHANGEFUNC func, void* data) {
+    impl->changeListeners.emplace_back(SChangeListener{.pattern = pattern, .func = func, .data = data});
+}
+
+void CConfig::removeChangeListener(const char* pattern, PCONFIGCHANGEFUNC func) {
+    std::erase_if(impl->changeListeners, [pattern, func](const auto& l) { return l.func == func && l.pattern == pattern; });
+}
+
+void CConfigImpl::snapshotForChanges() {
+    // plain values never get added after commence(), so the pointers only have to be gathered once
+    if (valueSnapshot.size() != values.size()) {
+        valueSnapshot.clear();
+        for (auto& [name, value] : values) {
+            valueSnapshot.emplace_back(SValueSnapshot{.name = &name, .value = &value});
+        }
+    }
+
+    for (auto& s : valueSnapshot) {
+        s.value->snapshot(s.before);
+    }
+
+    specialSnapshot.clear();
+    for (const auto& sc : specialCategories) {
+        auto& snap = specialSnapshot.emplace_back(SSpecialCategorySnapshot{.name = sc->name, .key = sc->isStatic ? "" : sc->indexedKey});
+        snap.values.reserve(sc->values.size());
+        for (const auto& [name, value] : sc->values) {
+            value.snapshot(snap.values.emplace_back(name, SConfigDefaultValue{}).second);
+        }
+    }
+}
+
+void CConfigImpl::collectChanges() {
+    changeRecords.clear();
+
+    for (const auto& s : valueSnapshot) {
+        if (s.value->sameAs(s.before))
+            continue;
+
+        auto& record = recordChange(CONFIG_CHANGE_VALUE, *s.name, "", "");
+        record.value = s.value;
+        if (!changeListeners.empty())
+            record.before = s.before;
+    }
+
+    std::unordered_map<std::string, SSpecialCategorySnapshot*> old;
+    for (auto& snap : specialSnapshot) {
+        old.try_emplace(snap.name + '\0' + snap.key, &snap);
+    }
+
+    for (const auto& sc : specialCategories) {
+        const std::string KEY = sc->isStatic ? "" : sc->indexedKey;
+        const auto        IT  = old.find(sc->name + '\0' + KEY);
+
+        if (IT == old.end() || IT->second->matched) {
+            recordChange(CONFIG_CHANGE_SPECIAL_ADDED, "", sc->name, KEY);
+            continue;
+        }
+
+        auto& snap   = *IT->second;
+        snap.matched = true;
+
+        // both got their values in the same order from the same defaults, so the index almost always lines up
+        size_t i = 0;
+        for (auto& [name, value] : sc->values) {
+            auto before = i < snap.values.size() && snap.values[i].first == name ? snap.values.begin() + i :
+                                                                                    std::ranges::find_if(snap.values, [&name](const auto& v) { return v.first == name; });
+            ++i;
+
+            if (before != snap.values.end() && value.sameAs(before->second))
+                continue;
+
+            auto& record = recordChange(CONFIG_CHANGE_SPECIAL_VALUE, name, sc->name, KEY);
+            record.value = &value;
+            if (!changeListeners.empty() && before != snap.values.end())
+                record.before = before->second;
+        }
+    }
+
+    for (const auto& snap : specialSnapshot) {
+        if (!snap.matched)
+            recordChange(CONFIG_CHANGE_SPECIAL_REMOVED, "", snap.name, snap.key);
+    }
+
+    publishChanges();
+}
+
+void CConfigImpl::trace(STraceEvent& event) {
+    event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    traceFunc(event, traceData);
+}
+
+CTraceSpan::CTraceSpan(CConfigImpl* impl, eTraceSpan span, const char* name) {
+    if (!impl->traceFunc)
+        return;
+
+    m_pImpl = impl;
+    m_event = STraceEvent{.begin = true, .span = span, .name = name, .file = impl->currentFile, .line = impl->currentLine};
+    impl->trace(m_event);
+}
+
+CTraceSpan::~CTraceSpan() {
+    // tracing might've been turned off in the meantime
+    if (!m_pImpl || !m_pImpl->traceFunc)
+        return;
+
+    m_event.begin = false;
+    m_pImpl->trace(m_event);
+}
+
+void CConfig::setTraceCallback(PCONFIGTRACEFUNC func, void* data) {
+    impl->traceFunc = func;
+    impl->traceData = data;
+    impl->traceWriter.reset();
+}
+
+bool CConfig::writeTrace(const char* path) {
+    auto writer = std::make_unique<CChromeTraceWriter>();
+    if (!writer->open(path))
+        return false;
+
+    setTraceCallback(&CChromeTraceWriter::callback, writer.get());
+    impl->traceWriter = std::move(writer);
+    return true;
+}
+
+// 1-based column of the first non-whitespace char
+static int statementColumn(std::string_view line) {
+    const auto START = line.find_first_not_of(" \t");
+    return START == std::string_view::npos ? 1 : START + 1;
+}
+
+bool CConfig::openFrame(SParseFrame& frame, const char* file, std::shared_ptr<CConfigSource> prefetched) {
+    frame.file = file;
+
+    // a file a reparse sources gets its span once continueReparse() gets to it
+    if (!frame.resumable || frame.started)
+        frame.span.emplace(impl, TRACE_SPAN_FILE, frame.file.c_str());
+
+    CStatsTimer readTimer(impl->configOptions.collectStats, impl->stats.readNs);
+    frame.source = prefetched ? std::move(prefetched) : std::make_shared<CConfigSource>(file);
+    readTimer.stop();
+
+    // only files of a reparse, not ones parsed into the values afterwards
+    if (impl->recordsInputs() && impl->rootFrame)
+        impl->recordInput(file, *frame.source);
+
+    if (!frame.source->good())
+        return false;
+
+    frame.reader.emplace(frame.source->data());
+    impl->countStat(&SParseStats::bytesRead, frame.source->data().length());
+    return true;
+}
+
+// true at the end of the frame, false if the budget ran out, a source line left files to parse first or the parse was cancelled
+bool CConfig::parseFrame(SParseFrame& frame, SParseStep* step) {
+    const auto FILE         = frame.file.empty() ? nullptr : frame.file.c_str();
+    const auto FRAMESBEFORE = impl->sourceFrames.size();
+    bool       eof          = false;
+
+    const auto PREVFILE      = impl->currentFile;
+    const auto PREVLINE      = impl->currentLine;
+    const auto PREVRESUMABLE = impl->inResumableFrame;
+    impl->currentFile        = FILE;
+    impl->inResumableFrame   = frame.resumable;
+
+    while (true) {
+        if (impl->cancelled.load(std::memory_order_relaxed))
+            break;
+
+        if (step && step->exhausted())
+            break;
+
+        const auto line = frame.reader->next(frame.rawLineNum, frame.lineNum);
+
+        if (!line) {
+            switch (line.error()) {
+                case GETNEXTLINEFAILURE_EOF: break;
+                case GETNEXTLINEFAILURE_BACKSLASH:
+                    impl->parseErrors->add(PARSE_ERROR_TRAILING_BACKSLASH, FILE, 0, 0, "Last line ends with backslash");
+                    frame.errorsSeen = impl->parseErrors->errors.size();
+                    break;
+            }
+            eof = true;
+            break;
+        }
+
+        if (step)
+            step->lines++;
+
+        impl->countStat(&SParseStats::linesRead);
+        impl->currentLine = frame.lineNum;
+
+        const auto ERRORSBEFORE = impl->parseErrors->errors.size();
+        const auto RET          = parseLine(line.value());
+
+        if (RET.error && impl->parseErrors->errors.size() > ERRORSBEFORE) {
+            // a nested frame's errors, already listed, count them as ours too
+            frame.errorsSeen = impl->parseErrors->errors.size();
+        } else if ((!FILE || !impl->currentFlags.noError) && RET.error && (impl->parseErrors->errors.empty() || impl->configOptions.throwAllErrors)) {
+            // noError only silences files, never streams
+            impl->parseErrors->add(PARSE_ERROR_STATEMENT, FILE, frame.lineNum, statementColumn(line.value()), RET.errorStdString);
+            frame.errorsSeen = impl->parseErrors->errors.size();
+        }
+
+        // a source line left its files to continueReparse()
+        if (impl->sourceFrames.size() > FRAMESBEFORE)
+            break;
+    }
+
+    impl->currentFile      = PREVFILE;
+    impl->currentLine      = PREVLINE;
+    impl->inResumableFrame = PREVRESUMABLE;
+
+    return eof;
+}
+
+void CConfig::closeFrame(SParseFrame& frame) {
+    if (!impl->categories.empty()) {
+        if (impl->parseErrors->errors.empty() || impl->configOptions.throwAllErrors) {
+            impl->parseErrors->add(PARSE_ERROR_UNCLOSED_CATEGORY, frame.file.empty() ? nullptr : frame.file.c_str(), 0, 0, "Unclosed category at EOF");
+            frame.errorsSeen = impl->parseErrors->errors.size();
+        }
+
+        impl->categories.clear();
+    }
+
+    impl->currentSpecialCategory = nullptr;
+}
+
+CParseResult CConfig::finishFrame(SParseFrame& frame) {
+    CParseResult result;
+
+    closeFrame(frame);
+
+    if (frame.errorsSeen)
+        result.setErrors(impl->parseErrors, frame.errorsSeen);
+
+    return result;
+}
+
+CParseResult CConfig::parseRawStream(const std::string& stream) {
+    SParseFrame frame;
+    frame.reader.emplace(stream);
+    impl->countStat(&SParseStats::bytesRead, stream.length());
+
+    parseFrame(frame);
+    return finishFrame(frame);
+}
+
+CParseResult CConfig::parseFile(const char* file) {
+    // e.g. a source handler, the file belongs to the parse in progress
+    if (impl->onParsingThread())
+        return impl->staging->parseFile(file);
+
+    if (impl->rootFrame) {
+        // calling the handler again would parse it again, on top of the values it set
+        impl->replayable = false;
+    } else {
+        // the values aren't only what the inputs give anymore
+        impl->lastInputs.reset();
+    }
+
+    CErrorCollection errors(impl);
+    SParseFrame      frame;
+
+    if (!openFrame(frame, file)) {
+        CParseResult result;
+        result.setError("File failed to open");
+        return result;
+    }
+
+    // the file's reads and lines are counted on their own, don't count them as handler time too
+    if (impl->handlerTimer)
+        impl->handlerTimer->stop();
+
+    impl->sourceStack.emplace_back(file);
+    parseFrame(frame);
+    impl->sourceStack.pop_back();
+
+    if (impl->handlerTimer)
+        impl->handlerTimer->start();
+
+    return finishFrame(frame);
+}
+
+CParseResult CConfig::parseSource(std::string_view value) {
+    CParseResult result;
+
+    const auto   BASEDIR = impl->currentFile ? std::filesystem::path{impl->currentFile}.parent_path().string() : std::filesystem::current_path().string();
+    const auto   PATHS   = resolveSourcePaths(value, BASEDIR);
+
+    if (impl->recordsInputs())
+        impl->recordedInputs.sources.emplace_back(SSourceInput{.value = std::string{value}, .baseDir = BASEDIR, .paths = PATHS.value_or(std::vector<std::string>{})});
+
+    if (!PATHS) {
+        result.setError(PATHS.error());
+        return result;
+    }
 
-                ret   = h.func(LHS.c_str(), RHS.c_str());
-                found = true;
-            }
-        }
+    // a reparse's files are left to continueReparse(), so they're parsed within a step's budget too
+    const bool                                RESUMABLE = impl->rootFrame && impl->inResumableFrame;
+    std::vector<std::unique_ptr<SParseFrame>> opened;
 
-        if (ret.error)
-            return ret;
-    } else {
-        // has to be a set
-        if (line.contains("}")) {
-            // easiest. } or invalid.
-            if (line != "}") {
-                result.setError("Invalid config line");
-                return result;
-            }
+    if (impl->rootFrame && !impl->prefetching) {
+        if (!impl->prefetcher)
+            impl->prefetcher = std::make_unique<CSourcePrefetcher>();
 
-            if (impl->categories.empty()) {
-                result.setError("Stray category close");
-                return result;
+        impl->prefetcher->start(impl->rootFrame->source ? impl->rootFrame->source->data() : std::string_view{impl->rawConfigString}, impl->rootFrame->file);
+        impl->prefetching = true;
+    }
+
+    for (const auto& path : *PATHS) {
+        if (const auto IT = std::ranges::find(impl->sourceStack, path); IT != impl->sourceStack.end()) {
+            std::string cycle;
+            for (auto it = IT; it != impl->sourceStack.end(); ++it) {
+                cycle += *it + " -> ";
             }
 
-            impl->categories.pop_back();
+            result.setError(std::format("source: cycle {}{}", cycle, path));
+            break;
+        }
 
-            if (impl->categories.empty()) {
-                impl->currentSpecialKey      = "";
-                impl->currentSpecialCategory = nullptr;
-            }
-        } else {
-            // open a category.
-            if (!line.ends_with("{")) {
-                result.setError("Invalid category open, garbage after {");
-                return result;
-            }
+        auto frame       = std::make_unique<SParseFrame>();
+        frame->resumable = RESUMABLE;
+
+        if (!openFrame(*frame, path.c_str(), impl->prefetching ? impl->prefetcher->take(path) : nullptr)) {
+            result.setError(std::format("source: {} failed to open", path));
+            break;
+        }
 
-            line.pop_back();
-            line = trim(line);
-            impl->categories.push_back(line);
+        if (RESUMABLE) {
+            opened.emplace_back(std::move(frame));
+            continue;
         }
+
+        impl->sourceStack.emplace_back(path);
+        parseFrame(*frame);
+        impl->sourceStack.pop_back();
+
+        closeFrame(*frame);
+
+        if (!frame->errorsSeen)
+            continue;
+
+        // its errors are already in the list, the frame around it picks them up from there. Only parseDynamic() needs them in the result.
+        if (impl->rootFrame)
+            result.error = true;
+        else
+            result.setErrors(impl->parseErrors, frame->errorsSeen);
+    }
+
+    // the first file on top
+    for (auto it = opened.rbegin(); it != opened.rend(); ++it) {
+        impl->sourceFrames.emplace_back(std::move(*it));
     }
 
     return result;
 }
 
-CParseResult CConfig::parse() {
-    if (!m_bCommenced)
-        throw "Cannot parse: not commenced. You have to .commence() first.";
+void CConfigImpl::recordInput(const char* path, const CConfigSource& source) {
+    auto& input = recordedInputs.files.emplace_back(SParseInput{.path = path});
 
-    clearState();
+    if (!source.good())
+        return;
 
-    for (auto& [k, v] : impl->defaultValues) {
-        impl->values.at(k).defaultFrom(v);
-    }
-    for (auto& sc : impl->specialCategories) {
-        applyDefaultsToCat(*sc);
+    input.stamp = source.stamp();
+
+    if (!input.stamp) {
+        recordedInputs.complete = false;
+        return;
     }
 
-    CParseResult fileParseResult;
+    input.hash = hashBytes(source.data());
+}
 
-    if (impl->rawConfigString.empty()) {
-        bool fileExists = std::filesystem::exists(impl->path);
+// true if parsing again would read what the last parse did
+bool CConfigImpl::inputsUnchanged() {
+    if (!lastInputs || lastInputs->root != path)
+        return false;
 
-        // implies options.allowMissingConfig
-        if (impl->configOptions.allowMissingConfig && !fileExists)
-            return CParseResult{};
-        else if (!fileExists) {
-            CParseResult res;
-            res.setError("Config file is missing");
-            return res;
+    for (auto& input : lastInputs->files) {
+        const auto STAMP = stampFile(input.path.c_str());
+
+        if (!STAMP || !input.stamp) {
+            // still missing is unchanged
+            if (STAMP.has_value() != input.stamp.has_value())
+                return false;
+            continue;
         }
 
-        std::string canonical = std::filesystem::canonical(impl->path);
+        if (*STAMP == *input.stamp)
+            continue;
 
-        fileParseResult = parseFile(canonical.c_str());
-    } else {
-        fileParseResult = parseRawStream(impl->rawConfigString);
+        if (STAMP->size != input.stamp->size)
+            return false;
+
+        // touched, maybe not changed
+        CConfigSource source(input.path.c_str());
+        if (!source.good() || hashBytes(source.data()) != input.hash)
+            return false;
+
+        input.stamp = STAMP;
+    }
+
+    for (const auto& src : lastInputs->sources) {
+        if (resolveSourcePaths(src.value, src.baseDir).value_or(std::vector<std::string>{}) != src.paths)
+            return false;
     }
 
-    return fileParseResult;
+    // what the last parse looked up, misses included
+    for (const auto& [name, var] : envVariables) {
+        const char* VALUE = getenv(name.c_str());
+
+        if (!VALUE != !var || (VALUE && var->value != VALUE))
+            return false;
+    }
+
+    return true;
 }
 
-void CConfig::changeRootPath(const char* path) {
-    impl->path = path;
+void CConfig::setCacheFile(const char* path) {
+    impl->cachePath = path ? path : "";
 }
 
-CParseResult CConfig::parseRawStream(const std::string& stream) {
-    CParseResult      result;
+bool CConfigImpl::recordsInputs() const {
+    return configOptions.skipUnchanged || !cachePath.empty();
+}
 
-    int               rawLineNum = 0;
-    int               lineNum    = 0;
+// after a parse into this config, or a commit of one
+void CConfigImpl::keepInputs() {
+    if (recordsInputs() && recordedInputs.complete)
+        lastInputs = std::move(recordedInputs);
+    else
+        lastInputs.reset();
+}
 
-    std::stringstream str(stream);
+inline constexpr std::string_view CACHE_MAGIC   = "HYPRLANGCACHE";
+inline constexpr uint32_t         CACHE_VERSION = 1;
+inline constexpr uint32_t         CACHE_NONE    = UINT32_MAX;
 
-    while (true) {
-        const auto line = getNextLine(str, rawLineNum, lineNum);
+static void writeCacheValue(CCacheWriter& w, const SConfigDefaultValue& value) {
+    w.u8(value.type);
 
-        if (!line) {
-            switch (line.error()) {
-                case GETNEXTLINEFAILURE_EOF: break;
-                case GETNEXTLINEFAILURE_BACKSLASH:
-                    if (!impl->parseError.empty())
-                        impl->parseError += "\n";
-                    impl->parseError += std::format("Config error: Last line ends with backslash");
-                    result.setError(impl->parseError);
-                    break;
-            }
+    switch (value.type) {
+        case CONFIGDATATYPE_INT: w.u64(std::get<INT>(value.data)); break;
+        case CONFIGDATATYPE_FLOAT: w.f32(std::get<FLOAT>(value.data)); break;
+        case CONFIGDATATYPE_VEC2: {
+            const auto& VEC = std::get<SVector2D>(value.data);
+            w.f32(VEC.x);
+            w.f32(VEC.y);
             break;
         }
+        // CUSTOM keeps its string in the STR alternative
+        case CONFIGDATATYPE_STR:
+        case CONFIGDATATYPE_CUSTOM: w.str(std::get<std::string>(value.data)); break;
+        default: break;
+    }
+}
+
+static bool readCacheValue(CCacheReader& r, SConfigDefaultValue& value) {
+    const auto TYPE = r.u8();
+    if (TYPE > CONFIGDATATYPE_CUSTOM)
+        return false;
 
-        const auto RET = parseLine(line.value());
+    value.type = (eDataType)TYPE;
 
-        if (RET.error && (impl->parseError.empty() || impl->configOptions.throwAllErrors)) {
-            if (!impl->parseError.empty())
-                impl->parseError += "\n";
-            impl->parseError += std::format("Config error at line {}: {}", lineNum, RET.errorStdString);
-            result.setError(impl->parseError);
+    switch (value.type) {
+        case CONFIGDATATYPE_INT: value.data = (INT)r.u64(); break;
+        case CONFIGDATATYPE_FLOAT: value.data = r.f32(); break;
+        case CONFIGDATATYPE_VEC2: {
+            const auto X = r.f32();
+            value.data   = SVector2D{X, r.f32()};
+            break;
         }
+        case CONFIGDATATYPE_STR:
+        case CONFIGDATATYPE_CUSTOM: value.data = std::string{r.str()}; break;
+        default: return false;
     }
 
-    if (!impl->categories.empty()) {
-        if (impl->parseError.empty() || impl->configOptions.throwAllErrors) {
-            if (!impl->parseError.empty())
-                impl->parseError += "\n";
-            impl->parseError += std::format("Config error: Unclosed category at EOF");
-            result.setError(impl->parseError);
+    return r.good();
+}
+
+static void writeCacheIndices(CCacheWriter& w, const std::vector<size_t>& indices) {
+    w.u32(indices.size());
+    for (const auto IDX : indices) {
+        w.u64(IDX);
+    }
+}
+
+static std::vector<size_t> readCacheIndices(CCacheReader& r) {
+    std::vector<size_t> indices;
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        indices.emplace_back(r.u64());
+    }
+    return indices;
+}
+
+// what a cache file is valid for besides its inputs: the options that change parsing, and everything registered
+uint64_t CConfigImpl::schemaHash() const {
+    CCacheWriter w;
+    w.u32(CACHE_VERSION);
+    w.u8(configOptions.verifyOnly);
+    w.u8(configOptions.throwAllErrors);
+    w.u8(configOptions.allowMissingConfig);
+    w.u8(configOptions.builtinSource);
+    w.str(rawConfigString);
+
+    const auto writeDefaults = [&w](const std::unordered_map<std::string, SConfigDefaultValue>& defaults, std::string_view except) {
+        // unordered, sort them so the hash doesn't depend on insertion history
+        std::vector<const std::string*> names;
+        for (const auto& [name, value] : defaults) {
+            if (name != except)
+                names.emplace_back(&name);
         }
 
-        impl->categories.clear();
+        std::ranges::sort(names, [](const auto* a, const auto* b) { return *a < *b; });
+
+        w.u32(names.size());
+        for (const auto* name : names) {
+            w.str(*name);
+            writeCacheValue(w, defaults.at(*name));
+        }
+    };
+
+    writeDefaults(defaultValues, "");
+
+    w.u32(specialCategoryDescriptors.size());
+    for (const auto& desc : specialCategoryDescriptors) {
+        w.str(desc->name);
+        w.str(desc->key);
+        w.u8(desc->dontErrorOnMissing);
+        w.u8(desc->anonymous);
+        // parsing adds a default for the key, that one is part of the cache instead
+        writeDefaults(desc->defaultValues, desc->key.empty() ? "" : desc->key);
     }
 
-    impl->currentSpecialCategory = nullptr;
+    w.u32(handlers.size());
+    for (const auto& h : handlers) {
+        w.str(h.name);
+        w.u8(h.options.allowFlags);
+        w.u8(h.options.mainThreadOnly);
+    }
 
-    return result;
+    return hashBytes(w.data());
 }
 
-CParseResult CConfig::parseFile(const char* file) {
-    CParseResult  result;
+// the state right after a parse, and what it was parsed from
+void CConfig::writeCache() {
+    if (!impl->lastInputs || !impl->replayable)
+        return;
 
-    std::ifstream iffile(file);
-    if (!iffile.good()) {
-        result.setError("File failed to open");
-        return result;
+    CCacheWriter w;
+    w.str(CACHE_MAGIC);
+    w.u64(impl->schemaHash());
+
+    const auto& INPUTS = *impl->lastInputs;
+    w.str(INPUTS.root);
+
+    w.u32(INPUTS.files.size());
+    for (const auto& f : INPUTS.files) {
+        w.str(f.path);
+        w.u8(f.stamp.has_value());
+        w.u64(f.hash);
     }
 
-    int rawLineNum = 0;
-    int lineNum    = 0;
+    w.u32(INPUTS.sources.size());
+    for (const auto& src : INPUTS.sources) {
+        w.str(src.value);
+        w.str(src.baseDir);
+        w.u32(src.paths.size());
+        for (const auto& p : src.paths) {
+            w.str(p);
+        }
+    }
 
-    while (true) {
-        const auto line = getNextLine(iffile, rawLineNum, lineNum);
+    // what the parse looked up, misses included
+    w.u32(impl->envVariables.size());
+    for (const auto& [name, var] : impl->envVariables) {
+        w.str(name);
+        w.u8(var.has_value());
+        if (!var)
+            continue;
+        w.str(var->value);
+        writeCacheIndices(w, var->linesContainingVar);
+    }
 
-        if (!line) {
-            switch (line.error()) {
-                case GETNEXTLINEFAILURE_EOF: break;
-                case GETNEXTLINEFAILURE_BACKSLASH:
-                    if (!impl->parseError.empty())
-                        impl->parseError += "\n";
-                    impl->parseError += std::format("Config error in file {}: Last line ends with backslash", file);
-                    result.setError(impl->parseError);
-                    break;
-            }
-            break;
+    SConfigDefaultValue value;
+
+    w.u32(impl->values.size());
+    for (const auto& [name, v] : impl->values) {
+        w.str(name);
+        v.snapshot(value);
+        writeCacheValue(w, value);
+        w.u8(v.m_bSetByUser);
+    }
+
+    w.u32(impl->specialCategoryDescriptors.size());
+    for (const auto& desc : impl->specialCategoryDescriptors) {
+        const auto IT = desc->key.empty() ? desc->defaultValues.end() : desc->defaultValues.find(desc->key);
+        w.u8(IT != desc->defaultValues.end());
+        if (IT != desc->defaultValues.end())
+            writeCacheValue(w, IT->second);
+    }
+
+    // static ones too, var lines refer to them by position
+    std::unordered_map<const SSpecialCategory*, uint32_t> positions;
+
+    w.u32(impl->specialCategories.size());
+    for (const auto& sc : impl->specialCategories) {
+        positions[sc.get()] = positions.size();
+
+        w.u32(std::ranges::find_if(impl->specialCategoryDescriptors, [&sc](const auto& d) { return d.get() == sc->descriptor; }) - impl->specialCategoryDescriptors.begin());
+        w.u8(sc->isStatic);
+        w.str(sc->name);
+        w.str(sc->key);
+        w.str(sc->indexedKey);
+        w.u64(sc->anonymousID);
+
+        w.u32(sc->values.size());
+        for (const auto& [name, v] : sc->values) {
+            w.str(name);
+            v.snapshot(value);
+            writeCacheValue(w, value);
+            w.u8(v.m_bSetByUser);
         }
+    }
 
-        const auto RET = parseLine(line.value());
+    w.u32(impl->variables.size());
+    for (const auto& [name, var] : impl->variables) {
+        w.str(name);
+        w.str(var.value);
+        writeCacheIndices(w, var.linesContainingVar);
+    }
 
-        if (!impl->currentFlags.noError && RET.error && (impl->parseError.empty() || impl->configOptions.throwAllErrors)) {
-            if (!impl->parseError.empty())
-                impl->parseError += "\n";
-            impl->parseError += std::format("Config error in file {} at line {}: {}", file, lineNum, RET.errorStdString);
-            result.setError(impl->parseError);
+    w.u32(impl->varLines.size());
+    for (const auto& line : impl->varLines) {
+        w.str(line.line);
+        w.u32(line.categories.size());
+        for (const auto& c : line.categories) {
+            w.str(c);
         }
+        w.u32(line.specialCategory && positions.contains(line.specialCategory) ? positions.at(line.specialCategory) : CACHE_NONE);
+        w.str(line.defines);
     }
 
-    iffile.close();
+    w.u32(impl->handlerCalls.size());
+    for (const auto& call : impl->handlerCalls) {
+        w.u32(call.handler);
+        w.str(call.command);
+        w.str(call.value);
+        w.str(call.file);
+        w.u32(call.line);
+    }
 
-    if (!impl->categories.empty()) {
-        if (impl->parseError.empty() || impl->configOptions.throwAllErrors) {
-            if (!impl->parseError.empty())
-                impl->parseError += "\n";
-            impl->parseError += std::format("Config error in file {}: Unclosed category at EOF", file);
-            result.setError(impl->parseError);
+    // it's only a cache, the next parse() just parses if this fails
+    w.writeTo(impl->cachePath);
+}
+
+// nullopt if there's no cache file or it doesn't match, parse() parses then
+std::optional<CParseResult> CConfig::loadCache() {
+    const CConfigSource CACHE(impl->cachePath.c_str());
+
+    if (!CACHE.good())
+        return std::nullopt;
+
+    const auto SCHEMA = impl->schemaHash();
+
+    beginPending();
+    impl->pending->fromCache                     = true;
+    impl->staging->impl->deferMainThreadHandlers = false;
+
+    bool loaded = false;
+
+    try {
+        CParsingGuard guard(impl);
+        loaded = impl->staging->readCache(CACHE.data(), SCHEMA);
+    } catch (...) {
+        cancelParse();
+        throw;
+    }
+
+    if (!loaded) {
+        cancelParse();
+        return std::nullopt;
+    }
+
+    return applyPending();
+}
+
+// into this config, like a parse would. False on any mismatch, what's left behind is reset by the next parse.
+bool CConfig::readCache(std::string_view data, uint64_t schemaHash) {
+    CCacheReader r(data);
+
+    if (r.str() != CACHE_MAGIC || r.u64() != schemaHash || r.str() != impl->path)
+        return false;
+
+    impl->stats = {};
+    resetToDefaults();
+    impl->recordedInputs = {.root = impl->path};
+
+    // stamps don't say much across runs, every file has to hash the same
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        const std::string PATH   = std::string{r.str()};
+        const bool        OPENED = r.u8();
+        const auto        HASH   = r.u64();
+        const auto        SOURCE = CConfigSource(PATH.c_str());
+
+        if (SOURCE.good() != OPENED)
+            return false;
+
+        impl->recordInput(PATH.c_str(), SOURCE);
+
+        if (OPENED && impl->recordedInputs.files.back().hash != HASH)
+            return false;
+    }
+
+    if (!impl->recordedInputs.complete)
+        return false;
+
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        SSourceInput src{.value = std::string{r.str()}, .baseDir = std::string{r.str()}};
+        for (uint32_t j = 0, paths = r.u32(); j < paths && r.good(); ++j) {
+            src.paths.emplace_back(r.str());
         }
 
-        impl->categories.clear();
+        if (resolveSourcePaths(src.value, src.baseDir).value_or(std::vector<std::string>{}) != src.paths)
+            return false;
+
+        impl->recordedInputs.sources.emplace_back(std::move(src));
     }
 
-    impl->currentSpecialCategory = nullptr;
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        const std::string NAME = std::string{r.str()};
+        const bool        SET  = r.u8();
+        const char*       NOW  = getenv(NAME.c_str());
 
-    return result;
+        if (!SET) {
+            if (NOW)
+                return false;
+            impl->envVariables.emplace(NAME, std::nullopt);
+            continue;
+        }
+
+        SVariable var{.name = NAME, .value = std::string{r.str()}, .linesContainingVar = readCacheIndices(r)};
+        if (!NOW || var.value != NOW)
+            return false;
+
+        impl->envVariables.emplace(NAME, std::move(var));
+    }
+
+    // inputs match, from here on a mismatch means a broken file
+    const auto readValues = [&r](CStringMap<CConfigValue>& values, CValueArena* arena) {
+        SConfigDefaultValue value;
+
+        for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+            const auto NAME = r.str();
+            if (!readCacheValue(r, value))
+                return false;
+
+            const bool SETBYUSER = r.u8();
+            const auto IT        = values.find(NAME);
+
+            if (IT == values.end() || (eDataType)IT->second.m_eType != value.type)
+                return false;
+
+            IT->second.defaultFrom(value, arena);
+            IT->second.m_bSetByUser = SETBYUSER;
+        }
+
+        return r.good();
+    };
+
+    if (!readValues(impl->values, &impl->valueArena))
+        return false;
+
+    if (r.u32() != impl->specialCategoryDescriptors.size())
+        return false;
+
+    for (const auto& desc : impl->specialCategoryDescriptors) {
+        if (!r.u8())
+            continue;
+
+        SConfigDefaultValue value;
+        if (!readCacheValue(r, value))
+            return false;
+
+        desc->defaultValues.try_emplace(desc->key, std::move(value));
+    }
+
+    std::vector<SSpecialCategory*> loaded;
+
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        const auto DESCIDX     = r.u32();
+        const bool STATIC      = r.u8();
+        const auto NAME        = r.str();
+        const auto KEY         = r.str();
+        const auto INDEXEDKEY  = r.str();
+        const auto ANONYMOUSID = r.u64();
+
+        if (DESCIDX >= impl->specialCategoryDescriptors.size())
+            return false;
+
+        SSpecialCategory* cat = nullptr;
+
+        if (STATIC) {
+            const auto IT = impl->specialCategoryIndex.find(NAME);
+            cat           = IT == impl->specialCategoryIndex.end() ? nullptr : IT->second.staticCategory;
+            if (!cat)
+                return false;
+        } else {
+            cat              = impl->specialCategories.emplace_back(std::make_unique<SSpecialCategory>()).get();
+            cat->descriptor  = impl->specialCategoryDescriptors[DESCIDX].get();
+            cat->name        = NAME;
+            cat->key         = KEY;
+            cat->anonymousID = ANONYMOUSID;
+            applyDefaultsToCat(*cat);
+        }
+
+        if (!readValues(cat->values, cat->arena))
+            return false;
+
+        if (!STATIC)
+            impl->indexSpecialCategory(cat, INDEXEDKEY);
+
+        loaded.emplace_back(cat);
+    }
+
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        const std::string NAME = std::string{r.str()};
+        const auto [IT, NEW]   = impl->variables.try_emplace(NAME, SVariable{.name = NAME, .value = std::string{r.str()}, .linesContainingVar = readCacheIndices(r)});
+
+        if (!NEW)
+            return false;
+
+        impl->variableTrie.insert(NAME, &IT->second);
+    }
+
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        SVarLine line{.line = std::string{r.str()}};
+        for (uint32_t j = 0, cats = r.u32(); j < cats && r.good(); ++j) {
+            line.categories.emplace_back(r.str());
+        }
+
+        const auto CATIDX = r.u32();
+        if (CATIDX != CACHE_NONE && CATIDX >= loaded.size())
+            return false;
+
+        line.specialCategory = CATIDX == CACHE_NONE ? nullptr : loaded[CATIDX];
+        line.defines         = r.str();
+        impl->varLines.emplace_back(std::move(line));
+    }
+
+    // dynamic variable updates index varLines with these
+    const auto INDICESVALID = [this](const SVariable& var) { return std::ranges::all_of(var.linesContainingVar, [this](size_t idx) { return idx < impl->varLines.size(); }); };
+
+    if (!std::ranges::all_of(impl->variables, [&](const auto& v) { return INDICESVALID(v.second); }) ||
+        !std::ranges::all_of(impl->envVariables, [&](const auto& v) { return !v.second || INDICESVALID(*v.second); }))
+        return false;
+
+    // replayed by applyPending() once the values are in place
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); ++i) {
+        const auto IDX = r.u32();
+        if (IDX >= impl->handlers.size())
+            return false;
+
+        impl->deferredHandlers.emplace_back(SDeferredHandler{
+            .func = impl->handlers[IDX].func, .command = std::string{r.str()}, .value = std::string{r.str()}, .file = std::string{r.str()}, .line = (int)r.u32()});
+    }
+
+    return r.good() && r.atEnd();
 }
 
 CParseResult CConfig::parseDynamic(const char* line) {
+    CErrorCollection errors(impl);
+
+    impl->lastInputs.reset();
+    impl->changeRecords.clear();
+    impl->recordValueChanges = true;
+
     auto ret                     = parseLine(line, true);
     impl->currentSpecialCategory = nullptr;
+    impl->recordValueChanges     = false;
+
+    impl->publishChanges();
+
+    if (impl->configOptions.publishSnapshots)
+        impl->publishSnapshot();
+
+    impl->deliverChanges();
     return ret;
 }
 
 CParseResult CConfig::parseDynamic(const char* command, const char* value) {
-    auto ret                     = parseLine(std::string{command} + "=" + std::string{value}, true);
-    impl->currentSpecialCategory = nullptr;
-    return ret;
+    return parseDynamic((std::string{command} + "=" + value).c_str());
 }
 
 void CConfig::clearState() {
     impl->categories.clear();
-    impl->parseError = "";
-    impl->recheckEnv();
-    impl->variables = impl->envVariables;
+    // results from the last parse may still hold on to the old errors
+    if (impl->parseErrors.use_count() == 1)
+        impl->parseErrors->clear();
+    else
+        impl->parseErrors = std::make_shared<SParseErrorList>();
+    impl->collectingErrors = true;
+    impl->variables.clear();
+    impl->envVariables.clear();
+    impl->variableTrie.clear();
+    impl->varLines.clear();
+
+    for (auto& [name, index] : impl->specialCategoryIndex) {
+        index.byKey.clear();
+        index.keyed.clear();
+    }
+
+    impl->specialCategoryGeneration++;
+
     std::erase_if(impl->specialCategories, [](const auto& e) { return !e->isStatic; });
 }
 
 CConfigValue* CConfig::getConfigValuePtr(const char* name) {
-    const auto IT = impl->values.find(std::string{name});
+    return getConfigValuePtr(std::string_view{name});
+}
+
+CConfigValue* CConfig::getConfigValuePtr(std::string_view name) {
+    if (impl->onParsingThread())
+        return impl->staging->getConfigValuePtr(name);
+
+    const auto IT = impl->values.find(name);
     return IT == impl->values.end() ? nullptr : &IT->second;
 }
 
-CConfigValue* CConfig::getSpecialConfigValuePtr(const char* category, const char* name, const char* key) {
-    const std::string CAT  = category;
-    const std::string NAME = name;
-    const std::string KEY  = key ? key : "";
+CConfigValue* CConfigImpl::getSpecialValuePtr(std::string_view category, std::string_view name, std::string_view key) {
+    const auto PCAT = findSpecialCategory(category, key);
 
-    for (auto& sc : impl->specialCategories) {
-        if (sc->name != CAT || (!sc->isStatic && std::string{std::any_cast<const char*>(sc->values[sc->key].getValue())} != KEY))
-            continue;
+    if (!PCAT)
+        return nullptr;
 
-        const auto IT = sc->values.find(NAME);
-        if (IT == sc->values.end())
-            return nullptr;
+    const auto IT = PCAT->values.find(name);
+    return IT == PCAT->values.end() ? nullptr : &IT->second;
+}
 
-        return &IT->second;
-    }
+CConfigValue* CConfig::getSpecialConfigValuePtr(const char* category, const char* name, const char* key) {
+    if (impl->onParsingThread())
+        return impl->staging->getSpecialConfigValuePtr(category, name, key);
 
-    return nullptr;
+    return impl->getSpecialValuePtr(category, name, key ? key : "");
 }
 
 CConfigValue* CConfig::getAnyConfigValuePtr(const char* name) {
+    if (impl->onParsingThread())
+        return impl->staging->getAnyConfigValuePtr(name);
+
     const auto parsedName = parseConfigName(name);
     if (!parsedName.category.empty())
-        return getSpecialConfigValuePtr(parsedName.category.c_str(), parsedName.name.c_str(), parsedName.key.c_str());
-    return getConfigValuePtr(name);
+        return impl->getSpecialValuePtr(parsedName.category, parsedName.name, parsedName.key);
+    return getConfigValuePtr(std::string_view{name});
+}
+
+CConfigValueHandle CConfig::getConfigValueHandle(const char* name) {
+    if (impl->onParsingThread())
+        return impl->staging->getConfigValueHandle(name);
+
+    CConfigValueHandle handle;
+    handle.m_pConfig = this;
+
+    const auto parsedName = parseConfigName(name);
+
+    if (parsedName.category.empty()) {
+        handle.m_pValue = getConfigValuePtr(std::string_view{name});
+        return handle;
+    }
+
+    handle.m_bSpecial = true;
+    handle.m_category = parsedName.category;
+    handle.m_key      = parsedName.key;
+    handle.m_name     = parsedName.name;
+    handle.resolve();
+
+    return handle;
+}
+
+void CConfigValueHandle::resolve() {
+    m_iGeneration = m_pConfig->impl->specialCategoryGeneration;
+    m_pValue      = m_pConfig->impl->getSpecialValuePtr(m_category, m_name, m_key);
+}
+
+CConfigValue* CConfigValueHandle::get() {
+    // special categories got rebuilt, renamed or removed since we last looked
+    if (m_bSpecial && m_iGeneration != m_pConfig->impl->specialCategoryGeneration)
+        resolve();
+
+    return m_pValue;
 }
 
 void CConfig::registerHandler(PCONFIGHANDLERFUNC func, const char* name, SHandlerOptions options_) {
     SHandlerOptions options;
     std::memcpy(&options, &options_, seekABIStructSize(&options_, 0, sizeof(SHandlerOptions)));
     impl->handlers.push_back(SHandler{.name = name, .options = options, .func = func});
+    impl->indexHandler(impl->handlers.size() - 1);
+    impl->schemaChanged();
+
+    // handlers are shared by index
+    if (impl->staging)
+        impl->staging->registerHandler(func, name, options);
 }
 
 void CConfig::unregisterHandler(const char* name) {
     std::erase_if(impl->handlers, [name](const auto& other) { return std::string_view(other.name) == name; });
+    impl->rebuildHandlerIndex();
+    impl->schemaChanged();
+
+    if (impl->staging)
+        impl->staging->unregisterHandler(name);
 }
 
-bool CConfig::specialCategoryExistsForKey(const char* category, const char* key) {
-    for (auto& sc : impl->specialCategories) {
-        if (sc->isStatic)
-            continue;
+void CConfigImpl::indexHandler(size_t idx) {
+    const auto& h           = handlers[idx];
+    const auto  HANDLERNAME = std::string_view{h.name}.starts_with(':') ? std::string_view{h.name}.substr(1) : std::string_view{h.name};
 
-        if (sc->name != category || std::string{std::any_cast<const char*>(sc->values[sc->key].getValue())} != key)
-            continue;
+    if (h.options.allowFlags) {
+        if (const auto PIDXS = handlerIndex.flags.find(HANDLERNAME); PIDXS)
+            PIDXS->emplace_back(idx);
+        else
+            handlerIndex.flags.insert(HANDLERNAME, std::vector<size_t>{idx});
+    } else if (!h.name.contains(':'))
+        handlerIndex.exact[h.name].emplace_back(idx);
+    else
+        handlerIndex.scoped[std::string{HANDLERNAME}].emplace_back(idx);
+}
+
+void CConfigImpl::rebuildHandlerIndex() {
+    handlerIndex.exact.clear();
+    handlerIndex.scoped.clear();
+    handlerIndex.flags.clear();
 
-        return true;
+    for (size_t i = 0; i < handlers.size(); ++i) {
+        indexHandler(i);
     }
+}
+
+bool CConfig::specialCategoryExistsForKey(const char* category, const char* key) {
+    if (impl->onParsingThread())
+        return impl->staging->specialCategoryExistsForKey(category, key);
 
-    return false;
+    const auto IT = impl->specialCategoryIndex.find(std::string_view{category});
+    return IT != impl->specialCategoryIndex.end() && IT->second.byKey.contains(std::string_view{key});
 }
 
 /* if len != 0, out needs to be freed */
 void CConfig::retrieveKeysForCat(const char* category, const char*** out, size_t* len) {
-    size_t count = 0;
-    for (auto& sc : impl->specialCategories) {
-        if (sc->isStatic)
-            continue;
-
-        if (sc->name != category)
-            continue;
+    if (impl->onParsingThread())
+        return impl->staging->retrieveKeysForCat(category, out, len);
 
-        count++;
-    }
+    const auto IT = impl->specialCategoryIndex.find(std::string_view{category});
 
-    if (count == 0) {
+    if (IT == impl->specialCategoryIndex.end() || IT->second.keyed.empty()) {
         *len = 0;
         return;
     }
 
-    *out            = (const char**)calloc(1, count * sizeof(const char*));
-    size_t counter2 = 0;
-    for (auto& sc : impl->specialCategories) {
-        if (sc->isStatic)
-            continue;
-
-        if (sc->name != category)
-            continue;
+    const auto& KEYED = IT->second.keyed;
 
+    *out              = (const char**)calloc(1, KEYED.size() * sizeof(const char*));
+    for (size_t i = 0; i < KEYED.size(); ++i) {
         // EVIL, but the pointers will be almost instantly discarded by the caller
-        (*out)[counter2++] = (const char*)sc->values[sc->key].m_pData;
+        (*out)[i] = (const char*)KEYED[i]->values[KEYED[i]->key].m_pData;
     }
 
-    *len = count;
+    *len = KEYED.size();
 }
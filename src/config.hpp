@@ -1,10 +1,36 @@
 #include "public.hpp"
+#include "reader.hpp"
+#include "trie.hpp"
+#include "arena.hpp"
+#include "trace.hpp"
+#include "source.hpp"
 
 #include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <future>
+#include <thread>
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 #include <expected>
+#include <variant>
+#include <utility>
+
+// allows probing string-keyed maps with a string_view without allocating
+struct SStringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view str) const {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+template <typename T>
+using CStringMap = std::unordered_map<std::string, T, SStringHash, std::equal_to<>>;
 
 struct SHandler {
     std::string                  name = "";
@@ -12,19 +38,21 @@ struct SHandler {
     Hyprlang::PCONFIGHANDLERFUNC func = nullptr;
 };
 
-struct SVariable {
-    std::string name  = "";
-    std::string value = "";
+// a parsed line that referenced variables, re-evaluated on dynamic variable updates
+struct SVarLine {
+    std::string              line;
+    std::vector<std::string> categories;
+    SSpecialCategory*        specialCategory = nullptr; // if applicable
+    std::string              defines         = "";      // name of the variable this line sets, if it is one
+};
 
-    struct SVarLine {
-        std::string              line;
-        std::vector<std::string> categories;
-        SSpecialCategory*        specialCategory = nullptr; // if applicable
-    };
+struct SVariable {
+    std::string         name  = "";
+    std::string         value = "";
 
-    std::vector<SVarLine> linesContainingVar; // for dynamic updates
+    std::vector<size_t> linesContainingVar; // indices into CConfigImpl::varLines, for dynamic updates
 
-    bool                  truthy() {
+    bool                truthy() {
         return value.length() > 0;
     }
 };
@@ -41,8 +69,9 @@ enum eDataType {
 
 // CUSTOM is stored as STR!!
 struct SConfigDefaultValue {
-    std::any  data;
-    eDataType type = CONFIGDATATYPE_EMPTY;
+    // alternatives are in eDataType order, CUSTOM keeps its default string in the STR one
+    std::variant<std::monostate, Hyprlang::INT, Hyprlang::FLOAT, std::string, Hyprlang::SVector2D> data;
+    eDataType                                                                                      type = CONFIGDATATYPE_EMPTY;
 
     // this sucks but I have no better idea
     Hyprlang::PCONFIGCUSTOMVALUEHANDLERFUNC handler = nullptr;
@@ -58,57 +87,358 @@ struct SSpecialCategoryDescriptor {
 };
 
 struct SSpecialCategory {
+    ~SSpecialCategory();
+
     SSpecialCategoryDescriptor*                             descriptor = nullptr;
+    CValueArena*                                            arena      = nullptr; // where the payloads of values live, set when defaults are applied
     std::string                                             name       = "";
     std::string                                             key        = ""; // empty means no key
-    std::unordered_map<std::string, Hyprlang::CConfigValue> values;
+    CStringMap<Hyprlang::CConfigValue>                      values;
     bool                                                    isStatic = false;
 
     void                                                    applyDefaults();
 
     // for easy anonymous ID'ing
     size_t anonymousID = 0;
+
+    // value of the key field this category is currently indexed under
+    std::string indexedKey = "";
 };
 
+// all special categories sharing a name, looked up by the value of their key
+struct SSpecialCategoryIndex {
+    SSpecialCategory*              staticCategory = nullptr;
+    CStringMap<SSpecialCategory*>  byKey;
+    std::vector<SSpecialCategory*> keyed; // in creation order
+};
+
+// views into the name that was parsed
 struct SParsedConfigName {
-    std::string category = "";
-    std::string key      = "";
-    std::string name     = "";
+    std::string_view category = "";
+    std::string_view key      = "";
+    std::string_view name     = "";
+};
+
+// adds the time it ran to a SParseStats field. Doesn't read the clock when stats are off.
+class CStatsTimer {
+  public:
+    CStatsTimer(bool enabled, uint64_t& target, bool running = true) : m_pTarget(enabled ? &target : nullptr) {
+        if (running)
+            start();
+    }
+
+    ~CStatsTimer() {
+        stop();
+    }
+
+    void start() {
+        if (!m_pTarget || m_bRunning)
+            return;
+        m_bRunning = true;
+        m_begin    = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        if (!m_bRunning)
+            return;
+        m_bRunning = false;
+        *m_pTarget += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_begin).count();
+    }
+
+  private:
+    uint64_t*                             m_pTarget  = nullptr;
+    bool                                  m_bRunning = false;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+// makes timer the one parseFile() pauses while a handler parses a file itself, for as long as it lives
+class CHandlerTimerScope {
+  public:
+    CHandlerTimerScope(CStatsTimer*& slot, CStatsTimer& timer) : m_slot(slot), m_pPrev(std::exchange(slot, &timer)) {
+        ;
+    }
+
+    ~CHandlerTimerScope() {
+        m_slot = m_pPrev;
+    }
+
+  private:
+    CStatsTimer*& m_slot;
+    CStatsTimer*  m_pPrev = nullptr;
+};
+
+// state before a parse(), diffed against afterwards to get the change set
+struct SValueSnapshot {
+    const std::string*      name  = nullptr;
+    Hyprlang::CConfigValue* value = nullptr;
+    SConfigDefaultValue     before;
+};
+
+struct SSpecialCategorySnapshot {
+    std::string                                              name, key;
+    std::vector<std::pair<std::string, SConfigDefaultValue>> values;
+    bool                                                     matched = false;
+};
+
+struct SChangeRecord {
+    Hyprlang::eConfigChangeType type = Hyprlang::CONFIG_CHANGE_VALUE;
+    std::string                 name, category, key;
+    SConfigDefaultValue         before;          // for listeners
+    Hyprlang::CConfigValue*     value = nullptr; // the changed value, if it still exists
+};
+
+// what a CConfigSnapshot holds. Everything is shared_ptr so unchanged parts can be shared with the next snapshot.
+struct SSnapshotCategory {
+    CStringMap<std::shared_ptr<const Hyprlang::CConfigValue>> values;
+};
+
+struct SConfigSnapshotData {
+    CStringMap<std::shared_ptr<const Hyprlang::CConfigValue>> values;
+    CStringMap<std::shared_ptr<const SSnapshotCategory>>      specialCategories; // by "name\nkey", key empty for static ones
+    size_t                                                    generation = 0;
+};
+
+struct SChangeListener {
+    std::string                 pattern;
+    Hyprlang::PCONFIGCHANGEFUNC func = nullptr;
+    void*                       data = nullptr;
+};
+
+// a mainThreadOnly handler call an async parse left for applyPending()
+struct SDeferredHandler {
+    Hyprlang::PCONFIGHANDLERFUNC func = nullptr;
+    std::string                  command, value;
+    std::string                  file; // where the line was, for errors
+    int                          line = 0;
 };
 
-enum eGetNextLineFailure : uint8_t {
-    GETNEXTLINEFAILURE_EOF = 0,
-    GETNEXTLINEFAILURE_BACKSLASH,
+// a parse into the staging config that wasn't applied yet
+struct SPendingParse {
+    std::thread            worker; // not joinable for beginParse() and cache loads, which run on the calling thread
+    std::promise<void>     done;
+    std::exception_ptr     exception; // thrown on the worker, rethrown by applyPending()
+    Hyprlang::CParseResult result;
+    bool                   stepping  = false; // started by beginParse(), applied by the last step()
+    bool                   fromCache = false; // loaded from the cache file, nothing to write back
+};
+
+// a handler call the cache file replays
+struct SHandlerCall {
+    size_t      handler = 0; // index into CConfigImpl::handlers
+    std::string command, value;
+    std::string file; // where the line was, for errors
+    int         line = 0;
+};
+
+class CConfigImpl;
+
+// emits the begin of a span now and its end when it goes out of scope. Does nothing when not tracing.
+class CTraceSpan {
+  public:
+    CTraceSpan(CConfigImpl* impl, Hyprlang::eTraceSpan span, const char* name);
+    ~CTraceSpan();
+
+    CTraceSpan(const CTraceSpan&)            = delete;
+    CTraceSpan& operator=(const CTraceSpan&) = delete;
+
+  private:
+    CConfigImpl*         m_pImpl = nullptr;
+    Hyprlang::STraceEvent m_event;
+};
+
+// one file or stream being parsed, resumable between lines
+struct SParseFrame {
+    std::string                    file;   // empty for streams
+    std::shared_ptr<CConfigSource> source; // files only
+    std::optional<CLineReader>     reader;
+    int                            rawLineNum = 0;
+    int                            lineNum    = 0;
+    size_t                         errorsSeen = 0;    // errors up to and including the last one this frame added
+    std::optional<CTraceSpan>      span;              // files only, open while the frame is parsed
+    bool                           resumable = false; // a reparse's, its source lines leave their files to continueReparse()
+    bool                           started   = false; // a sourced file continueReparse() got to
+};
+
+// one step()'s budget, shared by every frame it goes through
+struct SParseStep {
+    explicit SParseStep(const Hyprlang::SParseBudget& budget);
+
+    // at least one line per step, so stepping always gets somewhere
+    bool                                                 exhausted() const;
+
+    size_t                                               maxLines = 0; // 0 for no limit
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    size_t                                               lines = 0; // parsed so far
+};
+
+// a file a parse read, or tried to
+struct SParseInput {
+    std::string               path;
+    std::optional<SFileStamp> stamp;    // nullopt if it failed to open
+    size_t                    hash = 0; // of the contents
+};
+
+// a builtin source line, its glob may match other files next time
+struct SSourceInput {
+    std::string              value, baseDir;
+    std::vector<std::string> paths; // what it resolved to, empty on error
+};
+
+// what a parse depended on besides the schema and env, see SConfigOptions::skipUnchanged
+struct SParseInputs {
+    std::string               root; // CConfigImpl::path at the time
+    std::vector<SParseInput>  files;
+    std::vector<SSourceInput> sources;
+    bool                      complete = true; // false if something was read that can't be stamped, e.g. a pipe
+    Hyprlang::CParseResult    result;          // what parsing these gave
+};
+
+// errors collected during one parse. Only ever appended to, results remember how many were theirs.
+struct SParseErrorList {
+    std::vector<Hyprlang::SParseError> errors;
+    std::deque<std::string>            strings; // what the errors point into, a deque so nothing moves
+
+    void                               add(Hyprlang::eParseErrorCode code, const char* file, int line, int column, std::string_view message);
+    std::string                        join(size_t count) const;
+    void                               clear();
 };
 
 class CConfigImpl {
   public:
+    // has to outlive every value below, so it goes first
+    CValueArena valueArena;
+
     std::string path         = "";
     std::string originalPath = "";
 
     // if not-empty, used instead of path
     std::string                                              rawConfigString = "";
 
-    std::unordered_map<std::string, Hyprlang::CConfigValue>  values;
+    CStringMap<Hyprlang::CConfigValue>                       values;
     std::unordered_map<std::string, SConfigDefaultValue>     defaultValues;
     std::vector<SHandler>                                    handlers;
-    std::vector<SVariable>                                   variables;
-    std::vector<SVariable>                                   envVariables;
+    CStringMap<SVariable>                                    variables;
+    CStringMap<std::optional<SVariable>>                     envVariables; // resolved lazily and cached for one parse, misses included
+    CPrefixTrie<SVariable*>                                  variableTrie; // over the names in variables
+    std::vector<SVarLine>                                    varLines;     // every line that used a variable, once, in parse order
+    bool                                                     reevaluatingVariables = false;
     std::vector<std::unique_ptr<SSpecialCategory>>           specialCategories;
     std::vector<std::unique_ptr<SSpecialCategoryDescriptor>> specialCategoryDescriptors;
+    CStringMap<SSpecialCategoryIndex>                        specialCategoryIndex;
+    CPrefixTrie<SSpecialCategoryDescriptor*>                 descriptorTrie; // over "name:" of every descriptor
+    size_t                                                   specialCategoryGeneration = 0; // bumped whenever special values may have moved, see CConfigValueHandle
 
     std::vector<std::string>                                 categories;
     std::string                                              currentSpecialKey      = "";
     SSpecialCategory*                                        currentSpecialCategory = nullptr; // if applicable
 
-    std::string                                              parseError = "";
+    std::shared_ptr<SParseErrorList>                         parseErrors      = std::make_shared<SParseErrorList>();
+    bool                                                     collectingErrors = false; // a parse is appending to parseErrors, its results share the list
+
+    // indices into handlers, rebuilt whenever one is removed
+    struct {
+        CStringMap<std::vector<size_t>>  exact;  // unscoped handlers
+        CStringMap<std::vector<size_t>>  scoped; // by full category path, e.g. cat:subcat:name
+        CPrefixTrie<std::vector<size_t>> flags;  // allowFlags handlers, matched as prefixes
+    } handlerIndex;
+
+    void indexHandler(size_t idx);
+    void rebuildHandlerIndex();
 
     Hyprlang::SConfigOptions                                 configOptions;
 
+    Hyprlang::SParseStats                                    stats;
+    CStatsTimer*                                             handlerTimer = nullptr; // of the handler running right now, if any
+
+    Hyprlang::PCONFIGTRACEFUNC                               traceFunc = nullptr;
+    void*                                                    traceData = nullptr;
+    std::unique_ptr<CChromeTraceWriter>                      traceWriter; // set by writeTrace()
+    const char*                                              currentFile = nullptr; // file and line being parsed, for trace events
+    int                                                      currentLine = 0;
+
+    void                                                     trace(Hyprlang::STraceEvent& event);
+
+    // change set of the last parse() / parseDynamic()
+    std::vector<SChangeRecord>                               changeRecords;
+    std::vector<Hyprlang::SConfigChange>                     changes; // views into changeRecords
+    bool                                                     recordValueChanges = false; // parseDynamic records as values are set, parse() diffs snapshots
+    std::vector<SValueSnapshot>                              valueSnapshot;
+    std::vector<SSpecialCategorySnapshot>                    specialSnapshot;
+
+    void                                                     snapshotForChanges();
+    void                                                     collectChanges();
+    std::vector<SChangeListener>                             changeListeners;
+
+    SChangeRecord&                                           recordChange(Hyprlang::eConfigChangeType type, std::string_view name, std::string_view category, std::string_view key);
+    void                                                     publishChanges();
+    void                                                     deliverChanges();
+
+    // see SConfigOptions::publishSnapshots
+    std::atomic<std::shared_ptr<const Hyprlang::CConfigSnapshot>> snapshot;
+    bool                                                     snapshotStale = true; // values changed outside of a parse, don't reuse anything
+
+    void                                                     publishSnapshot();
+    static std::shared_ptr<const Hyprlang::CConfigValue>     snapshotValue(const Hyprlang::CConfigValue& value);
+
+    // parseAsync() and beginParse() parse into this copy of the schema, applyPending() copies the result over.
+    // Made once, schema changes are made to both, so pointers handlers got from it stay valid.
+    std::unique_ptr<Hyprlang::CConfig>                       staging;
+    std::unique_ptr<SPendingParse>                           pending;
+    int                                                      pendingFD = -1;
+
+    // set on the staging config
+    bool                                                     deferMainThreadHandlers = false;
+    std::vector<SDeferredHandler>                            deferredHandlers;
+    std::unique_ptr<SParseFrame>                             rootFrame;                // of a reparse in progress
+    std::vector<std::unique_ptr<SParseFrame>>                sourceFrames;             // files it sourced that aren't done yet, the one being parsed last
+    bool                                                     inResumableFrame = false; // the frame in parseFrame() right now is one of those
+    std::optional<CTraceSpan>                                parseSpan;
+    Hyprlang::CParseResult                                   reparseResult;
+    std::atomic<bool>                                        cancelled = false; // checked between lines
+
+    // see SConfigOptions::builtinSource
+    std::unique_ptr<CSourcePrefetcher>                       prefetcher;          // made at the first source line, its workers stay
+    bool                                                     prefetching = false; // for the reparse in progress
+    std::vector<std::string>                                 sourceStack;         // files being parsed, outermost first
+
+    bool                                                     onParsingThread() const;
+
+    // see SConfigOptions::skipUnchanged
+    SParseInputs                                             recordedInputs; // of the reparse in progress
+    std::optional<SParseInputs>                              lastInputs;     // of the parse the values are from, nullopt if they aren't anymore
+
+    void                                                     recordInput(const char* path, const CConfigSource& source);
+    bool                                                     inputsUnchanged();
+
+    // see CConfig::setCacheFile()
+    std::string                                              cachePath;
+    bool                                                     committedAParse = false; // the cache is only loaded before that
+    std::vector<SHandlerCall>                                handlerCalls; // of the reparse in progress, in order
+    bool                                                     replayable = true; // false once a handler parsed a file itself
+
+    bool                                                     recordsInputs() const;
+    void                                                     keepInputs();
+    void                                                     schemaChanged(); // values, categories or handlers were added or removed
+    uint64_t                                                 schemaHash() const;
+
+    void                                                     countStat(size_t Hyprlang::SParseStats::*counter, size_t n = 1) {
+        if (configOptions.collectStats)
+            stats.*counter += n;
+    }
+
     std::optional<std::string>                               parseComment(const std::string& comment);
     std::expected<float, std::string>                        parseExpression(const std::string& s);
-    SVariable*                                               getVariable(const std::string& name);
-    void                                                     recheckEnv();
+    SVariable*                                               getVariable(std::string_view name);
+    SVariable*                                               getEnvVariable(std::string_view name);
+    bool                                                     expandVariables(std::string_view in, std::string& out, std::vector<SVariable*>& used, size_t depth = 0);
+    std::vector<size_t>                                      linesAffectedBy(const SVariable& var);
+
+    SSpecialCategoryDescriptor*                              getDescriptor(std::string_view name);
+    std::vector<SSpecialCategoryDescriptor*>                 descriptorsFor(std::string_view valueName);
+    SSpecialCategory*                                        findSpecialCategory(std::string_view name, std::string_view key);
+    Hyprlang::CConfigValue*                                  getSpecialValuePtr(std::string_view category, std::string_view name, std::string_view key);
+    void                                                     indexSpecialCategory(SSpecialCategory* cat, std::string_view key);
+    void                                                     reindexSpecialCategoryKey(SSpecialCategory* cat);
 
     struct SIfBlockData {
         bool failed = false;
@@ -0,0 +1,145 @@
+#include "numeric.hpp"
+
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+static size_t skipSpace(std::string_view str) {
+    size_t i = 0;
+    while (i < str.length() && std::isspace((unsigned char)str[i])) {
+        ++i;
+    }
+
+    return i;
+}
+
+static bool isHexPrefix(std::string_view str, size_t i) {
+    return i + 1 < str.length() && str[i] == '0' && (str[i + 1] == 'x' || str[i + 1] == 'X');
+}
+
+std::expected<int64_t, eNumericError> parseInt(std::string_view str) {
+    int64_t    value     = 0;
+    const auto END       = str.data() + str.length();
+    const auto [PTR, EC] = std::from_chars(str.data(), END, value);
+
+    if (EC == std::errc::invalid_argument || PTR != END)
+        return std::unexpected(NUMERIC_INVALID);
+
+    if (EC == std::errc::result_out_of_range)
+        return std::unexpected(NUMERIC_OUT_OF_RANGE);
+
+    return value;
+}
+
+std::expected<int64_t, eNumericError> parseHexInt(std::string_view str) {
+    size_t i        = skipSpace(str);
+    bool   negative = false;
+
+    if (i < str.length() && (str[i] == '+' || str[i] == '-'))
+        negative = str[i++] == '-';
+
+    if (isHexPrefix(str, i))
+        i += 2;
+
+    // from_chars would take a second sign, strtoll doesn't
+    if (i >= str.length() || !std::isxdigit((unsigned char)str[i]))
+        return std::unexpected(NUMERIC_INVALID);
+
+    uint64_t   magnitude = 0;
+    const auto END       = str.data() + str.length();
+    const auto [PTR, EC] = std::from_chars(str.data() + i, END, magnitude, 16);
+
+    if (EC == std::errc::result_out_of_range)
+        return std::unexpected(NUMERIC_OUT_OF_RANGE);
+
+    if (EC != std::errc{} || PTR != END)
+        return std::unexpected(NUMERIC_INVALID);
+
+    constexpr uint64_t MAX = std::numeric_limits<int64_t>::max();
+
+    if (magnitude > MAX + (negative ? 1 : 0))
+        return std::unexpected(NUMERIC_OUT_OF_RANGE);
+
+    if (negative)
+        return magnitude == MAX + 1 ? std::numeric_limits<int64_t>::min() : -(int64_t)magnitude;
+
+    return (int64_t)magnitude;
+}
+
+// per byte: high bit set where the byte is >= LOW. Only valid for bytes below 0x80.
+static constexpr uint64_t bytesAtLeast(uint64_t bytes, uint8_t LOW) {
+    constexpr uint64_t ONES = 0x0101010101010101ULL;
+    constexpr uint64_t HIGH = 0x8080808080808080ULL;
+    return (bytes + (0x80 - LOW) * ONES) & HIGH;
+}
+
+std::expected<uint32_t, eNumericError> parseHexDigits(std::string_view str) {
+    constexpr uint64_t HIGH = 0x8080808080808080ULL;
+
+    if (str.empty() || str.length() > 8)
+        return std::unexpected(NUMERIC_INVALID);
+
+    // left pad with zeroes, so the first digit ends up in the lowest byte
+    char buf[8];
+    std::memset(buf, '0', sizeof(buf));
+    std::memcpy(buf + 8 - str.length(), str.data(), str.length());
+
+    uint64_t bytes = 0;
+    std::memcpy(&bytes, buf, sizeof(bytes));
+    if constexpr (std::endian::native == std::endian::big)
+        bytes = std::byteswap(bytes);
+
+    if (bytes & HIGH)
+        return std::unexpected(NUMERIC_INVALID);
+
+    const uint64_t LOWER = bytes | 0x2020202020202020ULL;
+    const uint64_t DIGIT = bytesAtLeast(bytes, '0') & ~bytesAtLeast(bytes, '9' + 1);
+    const uint64_t ALPHA = bytesAtLeast(LOWER, 'a') & ~bytesAtLeast(LOWER, 'f' + 1);
+
+    if ((DIGIT | ALPHA) != HIGH)
+        return std::unexpected(NUMERIC_INVALID);
+
+    // '0'-'9' are 0x30-0x39 and 'a'-'f' / 'A'-'F' end in 0x1-0x6, so the low nibble is the value, plus 9 for letters
+    uint64_t nibbles = (bytes & 0x0F0F0F0F0F0F0F0FULL) + (ALPHA >> 7) * 9;
+
+    // merge neighbours into bytes, then bytes into 16 bit halves, then the halves, most significant digit first
+    nibbles = ((nibbles & 0x000F000F000F000FULL) << 4) | ((nibbles >> 8) & 0x000F000F000F000FULL);
+    nibbles = ((nibbles & 0x000000FF000000FFULL) << 8) | ((nibbles >> 16) & 0x000000FF000000FFULL);
+
+    return (uint32_t)(((nibbles & 0xFFFF) << 16) | ((nibbles >> 32) & 0xFFFF));
+}
+
+std::expected<float, eNumericError> parseFloat(std::string_view str, size_t* consumed) {
+    size_t i        = skipSpace(str);
+    bool   negative = false;
+
+    // from_chars takes neither a leading + nor the 0x of hex floats, so strip both ourselves
+    if (i < str.length() && (str[i] == '+' || str[i] == '-'))
+        negative = str[i++] == '-';
+
+    if (i < str.length() && (str[i] == '+' || str[i] == '-'))
+        return std::unexpected(NUMERIC_INVALID);
+
+    auto format = std::chars_format::general;
+
+    if (isHexPrefix(str, i) && i + 2 < str.length() && (std::isxdigit((unsigned char)str[i + 2]) || str[i + 2] == '.')) {
+        format = std::chars_format::hex;
+        i += 2;
+    }
+
+    float      value     = 0;
+    const auto [PTR, EC] = std::from_chars(str.data() + i, str.data() + str.length(), value, format);
+
+    if (EC == std::errc::invalid_argument)
+        return std::unexpected(NUMERIC_INVALID);
+
+    if (EC == std::errc::result_out_of_range)
+        return std::unexpected(NUMERIC_OUT_OF_RANGE);
+
+    if (consumed)
+        *consumed = PTR - str.data();
+
+    return negative ? -value : value;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <string_view>
+
+enum eNumericError : uint8_t {
+    NUMERIC_INVALID = 0,
+    NUMERIC_OUT_OF_RANGE,
+};
+
+/*
+    Non-throwing, locale independent number parsing on top of std::from_chars.
+    Each one accepts exactly what the std::sto* call it replaced did.
+*/
+
+// -?[0-9]+, the whole string
+std::expected<int64_t, eNumericError> parseInt(std::string_view str);
+
+// like stoll(str, &pos, 16) with pos == size: leading whitespace, a sign and a 0x prefix are fine
+std::expected<int64_t, eNumericError> parseHexInt(std::string_view str);
+
+// up to 8 bare hex digits, no prefix, sign or whitespace. Made for colors, decodes all digits at once.
+std::expected<uint32_t, eNumericError> parseHexDigits(std::string_view str);
+
+// like stof(str, &pos): leading whitespace and a sign are fine, trailing junk is ignored.
+// consumed receives the length of the parsed prefix.
+std::expected<float, eNumericError> parseFloat(std::string_view str, size_t* consumed = nullptr);
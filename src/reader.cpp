@@ -0,0 +1,148 @@
+#include "reader.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+inline constexpr const char* MULTILINE_SPACE_CHARSET = " \t";
+// smaller files are copied. A mapping raises SIGBUS once the file is truncated under it, and sources live as long as a parse.
+inline constexpr off_t MMAP_MIN_SIZE = 1 << 20;
+
+static SFileStamp stampFromStat(const struct stat& st) {
+    return SFileStamp{.mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec, .size = (int64_t)st.st_size};
+}
+
+std::optional<SFileStamp> stampFile(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        return std::nullopt;
+
+    return stampFromStat(st);
+}
+
+CConfigSource::CConfigSource(const char* path) {
+    const int FD = open(path, O_RDONLY | O_CLOEXEC);
+    if (FD < 0)
+        return;
+
+    struct stat st;
+    const bool  STATED = fstat(FD, &st) == 0;
+
+    if (STATED && S_ISREG(st.st_mode))
+        m_stamp = stampFromStat(st);
+
+    if (STATED && S_ISREG(st.st_mode) && st.st_size >= MMAP_MIN_SIZE) {
+        void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+            m_pMapping    = mapping;
+            m_mappingSize = st.st_size;
+            m_data        = {(const char*)m_pMapping, m_mappingSize};
+            m_bGood       = true;
+            close(FD);
+            return;
+        }
+    }
+
+    // small, or not mappable, e.g. a pipe or a procfs file reporting a size of 0.
+    // One more byte than stat says, so a file that didn't change is read without growing the buffer.
+    size_t len = 0;
+    m_buffer.resize(STATED && S_ISREG(st.st_mode) && st.st_size > 0 ? st.st_size + 1 : 4096);
+
+    while (true) {
+        if (len == m_buffer.size())
+            m_buffer.resize(m_buffer.size() * 2);
+
+        const auto LEN = read(FD, m_buffer.data() + len, m_buffer.size() - len);
+
+        if (LEN < 0 && errno == EINTR)
+            continue;
+
+        if (LEN < 0) {
+            close(FD);
+            m_buffer.clear();
+            return;
+        }
+
+        if (LEN == 0)
+            break;
+
+        len += LEN;
+    }
+
+    close(FD);
+
+    m_buffer.resize(len);
+    m_data = m_buffer;
+    m_bGood = true;
+}
+
+CConfigSource::~CConfigSource() {
+    if (m_pMapping)
+        munmap(m_pMapping, m_mappingSize);
+}
+
+bool CConfigSource::good() const {
+    return m_bGood;
+}
+
+std::string_view CConfigSource::data() const {
+    return m_data;
+}
+
+std::optional<SFileStamp> CConfigSource::stamp() const {
+    return m_stamp;
+}
+
+CLineReader::CLineReader(std::string_view data) : m_data(data) {
+    ;
+}
+
+bool CLineReader::getline(std::string_view& out) {
+    if (m_pos >= m_data.length())
+        return false;
+
+    const auto NEWLINE = m_data.find('\n', m_pos);
+
+    if (NEWLINE == std::string_view::npos) {
+        out   = m_data.substr(m_pos);
+        m_pos = m_data.length();
+    } else {
+        out   = m_data.substr(m_pos, NEWLINE - m_pos);
+        m_pos = NEWLINE + 1;
+    }
+
+    return true;
+}
+
+std::expected<std::string_view, eGetNextLineFailure> CLineReader::next(int& rawLineNum, int& lineNum) {
+    std::string_view line;
+
+    if (!getline(line))
+        return std::unexpected(GETNEXTLINEFAILURE_EOF);
+
+    lineNum = ++rawLineNum;
+
+    if (line.empty() || line.back() != '\\')
+        return line;
+
+    m_joined = line;
+
+    while (!m_joined.empty() && m_joined.back() == '\\') {
+        const auto lastNonSpace = m_joined.length() < 2 ? std::string::npos : m_joined.find_last_not_of(MULTILINE_SPACE_CHARSET, m_joined.length() - 2);
+        m_joined.resize(lastNonSpace == std::string::npos ? 0 : lastNonSpace + 1);
+
+        std::string_view nextLine;
+        if (!getline(nextLine))
+            return std::unexpected(GETNEXTLINEFAILURE_BACKSLASH);
+
+        ++rawLineNum;
+        m_joined += nextLine;
+    }
+
+    return m_joined;
+}
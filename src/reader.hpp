@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <expected>
+#include <optional>
+#include <cstdint>
+
+enum eGetNextLineFailure : uint8_t {
+    GETNEXTLINEFAILURE_EOF = 0,
+    GETNEXTLINEFAILURE_BACKSLASH,
+};
+
+// what stat() says about a regular file, enough to tell it most likely didn't change
+struct SFileStamp {
+    int64_t mtimeNs = 0;
+    int64_t size    = 0;
+
+    bool    operator==(const SFileStamp&) const = default;
+};
+
+// nullopt if path is missing or not a regular file
+std::optional<SFileStamp> stampFile(const char* path);
+
+/*
+    Read-only contents of a config file. Regular files of a MiB or more are mmap'd, anything
+    else (smaller files, pipes, procfs) is read() into an owned buffer.
+    The data stays valid for the lifetime of the object, unless a mapped file is truncated meanwhile.
+*/
+class CConfigSource {
+  public:
+    CConfigSource(const char* path);
+    ~CConfigSource();
+
+    CConfigSource(const CConfigSource&)            = delete;
+    CConfigSource& operator=(const CConfigSource&) = delete;
+
+    bool                      good() const;
+    std::string_view          data() const;
+    std::optional<SFileStamp> stamp() const; // as of opening, nullopt if it isn't a regular file
+
+  private:
+    void*                     m_pMapping    = nullptr;
+    size_t                    m_mappingSize = 0;
+    std::string               m_buffer;
+    std::string_view          m_data;
+    bool                      m_bGood = false;
+    std::optional<SFileStamp> m_stamp;
+};
+
+/*
+    Splits a buffer into config lines, joining backslash continuations.
+    Returned views are valid until the next call to next().
+*/
+class CLineReader {
+  public:
+    CLineReader(std::string_view data);
+
+    std::expected<std::string_view, eGetNextLineFailure> next(int& rawLineNum, int& lineNum);
+
+  private:
+    bool             getline(std::string_view& out);
+
+    std::string_view m_data;
+    size_t           m_pos = 0;
+
+    // only used for multiline values
+    std::string m_joined;
+};
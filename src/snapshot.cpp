@@ -0,0 +1,107 @@
+#include "config.hpp"
+
+#include <unordered_set>
+
+using namespace Hyprlang;
+
+static std::string snapshotCategoryKey(std::string_view name, std::string_view key) {
+    std::string out;
+    out.reserve(name.length() + key.length() + 1);
+    out += name;
+    out += '\n';
+    out += key;
+    return out;
+}
+
+// custom data can only be copied by running the consumer's handler, and its dtor would then run on whichever
+// thread drops the snapshot, so custom values are kept as the string they were set from
+std::shared_ptr<const CConfigValue> CConfigImpl::snapshotValue(const CConfigValue& value) {
+    std::shared_ptr<CConfigValue> copy;
+
+    if (value.m_eType == CConfigValue::CONFIGDATATYPE_CUSTOM) {
+        SConfigDefaultValue effective;
+        value.snapshot(effective);
+        copy = std::make_shared<CConfigValue>(std::get<std::string>(effective.data).c_str());
+    } else
+        copy = std::make_shared<CConfigValue>(value);
+
+    copy->m_bSetByUser = value.m_bSetByUser;
+    return copy;
+}
+
+CConfigSnapshot::CConfigSnapshot() : m_pData(std::make_unique<SConfigSnapshotData>()) {
+    ;
+}
+
+CConfigSnapshot::~CConfigSnapshot() = default;
+
+const CConfigValue* CConfigSnapshot::getConfigValuePtr(std::string_view name) const {
+    const auto IT = m_pData->values.find(name);
+    return IT == m_pData->values.end() ? nullptr : IT->second.get();
+}
+
+const CConfigValue* CConfigSnapshot::getSpecialConfigValuePtr(std::string_view category, std::string_view name, std::string_view key) const {
+    const auto CATIT = m_pData->specialCategories.find(snapshotCategoryKey(category, key));
+    if (CATIT == m_pData->specialCategories.end())
+        return nullptr;
+
+    const auto IT = CATIT->second->values.find(name);
+    return IT == CATIT->second->values.end() ? nullptr : IT->second.get();
+}
+
+size_t CConfigSnapshot::generation() const {
+    return m_pData->generation;
+}
+
+void CConfigImpl::publishSnapshot() {
+    const auto                      PREV = snapshot.load();
+    const bool                      REUSE = PREV && !snapshotStale;
+
+    std::shared_ptr<CConfigSnapshot> next{new CConfigSnapshot()};
+    auto&                           data = *next->m_pData;
+    data.generation                      = PREV ? PREV->m_pData->generation + 1 : 0;
+
+    // everything that changed since PREV is in the change set of the parse that just finished
+    std::unordered_set<std::string> changedCategories;
+    if (REUSE) {
+        // still one pointer copy per value, only the values themselves are shared
+        data.values = PREV->m_pData->values;
+
+        for (const auto& r : changeRecords) {
+            if (r.type == CONFIG_CHANGE_VALUE)
+                data.values[r.name] = snapshotValue(*r.value);
+            else
+                changedCategories.emplace(snapshotCategoryKey(r.category, r.key));
+        }
+    } else {
+        for (const auto& [name, value] : values) {
+            data.values.emplace(name, snapshotValue(value));
+        }
+    }
+
+    for (const auto& sc : specialCategories) {
+        auto KEY = snapshotCategoryKey(sc->name, sc->isStatic ? "" : sc->indexedKey);
+
+        if (REUSE && !changedCategories.contains(KEY)) {
+            if (const auto IT = PREV->m_pData->specialCategories.find(KEY); IT != PREV->m_pData->specialCategories.end()) {
+                data.specialCategories.emplace(std::move(KEY), IT->second);
+                continue;
+            }
+        }
+
+        auto cat = std::make_shared<SSnapshotCategory>();
+        for (const auto& [name, value] : sc->values) {
+            cat->values.emplace(name, snapshotValue(value));
+        }
+
+        // duplicate keys resolve to the oldest category, same as lookups on the config do
+        data.specialCategories.try_emplace(std::move(KEY), std::move(cat));
+    }
+
+    snapshotStale = false;
+    snapshot.store(std::move(next));
+}
+
+std::shared_ptr<const CConfigSnapshot> CConfig::getSnapshot() const {
+    return impl->snapshot.load();
+}
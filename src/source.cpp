@@ -0,0 +1,182 @@
+#include "source.hpp"
+#include "tokenizer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <glob.h>
+
+// files are mostly small, more threads than this just wait on each other
+inline constexpr size_t MAX_PREFETCH_WORKERS = 4;
+
+std::expected<std::vector<std::string>, std::string> resolveSourcePaths(std::string_view value, const std::string& baseDir) {
+    std::string pattern{trimView(value)};
+
+    if (pattern.empty())
+        return std::unexpected("source: empty path");
+
+    if (pattern == "~" || pattern.starts_with("~/")) {
+        const char* HOME = getenv("HOME");
+        if (!HOME)
+            return std::unexpected("source: ~ used, but HOME is not set");
+
+        pattern = HOME + pattern.substr(1);
+    }
+
+    if (!pattern.starts_with('/'))
+        pattern = baseDir + "/" + pattern;
+
+    glob_t     globbed;
+    const auto RET = glob(pattern.c_str(), GLOB_MARK, nullptr, &globbed);
+
+    if (RET != 0) {
+        globfree(&globbed);
+        return std::unexpected(RET == GLOB_NOMATCH ? std::format("source: no file matches {}", pattern) : std::format("source: failed to expand {}", pattern));
+    }
+
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < globbed.gl_pathc; ++i) {
+        const std::string_view PATH = globbed.gl_pathv[i];
+
+        // GLOB_MARK ends directories with a /
+        if (PATH.ends_with('/'))
+            continue;
+
+        std::error_code ec;
+        const auto      CANONICAL = std::filesystem::canonical(PATH, ec);
+        paths.emplace_back(ec ? std::string{PATH} : CANONICAL.string());
+    }
+
+    globfree(&globbed);
+
+    return paths;
+}
+
+CSourcePrefetcher::~CSourcePrefetcher() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_bStopped = true;
+    }
+
+    m_cv.notify_all();
+
+    // nothing adds workers once stopped
+    for (auto& w : m_workers) {
+        w.join();
+    }
+}
+
+void CSourcePrefetcher::start(std::string_view rootData, const std::string& rootPath) {
+    stop();
+    queueFrom(rootData, rootPath, m_generation);
+}
+
+void CSourcePrefetcher::stop() {
+    std::lock_guard lock(m_mutex);
+    m_entries.clear();
+    m_queue.clear();
+    m_generation++;
+}
+
+std::shared_ptr<CConfigSource> CSourcePrefetcher::take(const std::string& path) {
+    std::unique_lock lock(m_mutex);
+
+    const auto       IT = m_entries.find(path);
+    if (IT == m_entries.end())
+        return nullptr;
+
+    // a reference, more entries might be added while we wait
+    auto& entry = IT->second;
+    m_cv.wait(lock, [&entry] { return entry.done; });
+
+    return entry.source;
+}
+
+void CSourcePrefetcher::queueFrom(std::string_view data, const std::string& path, size_t generation) {
+    const std::string        BASEDIR = path.empty() ? std::filesystem::current_path().string() : std::filesystem::path{path}.parent_path().string();
+
+    std::vector<std::string> found;
+    std::string              scratch;
+    size_t                   pos     = 0;
+    size_t                   ifDepth = 0;
+
+    while (pos < data.length()) {
+        const auto NEWLINE = std::min(data.find('\n', pos), data.length());
+        const auto TOKENS  = tokenizeLine(data.substr(pos, NEWLINE - pos), scratch);
+        pos                = NEWLINE + 1;
+
+        // whether a hyprlang if block is parsed depends on variables, like the values below
+        if (TOKENS.type == LINETYPE_DIRECTIVE) {
+            const auto DIRECTIVE = trimView(trimView(TOKENS.comment).substr(std::string_view{"hyprlang"}.length()));
+
+            if (DIRECTIVE.starts_with("if ") || DIRECTIVE.starts_with("if\t"))
+                ifDepth++;
+            else if ((DIRECTIVE == "endif" || DIRECTIVE.starts_with("endif ")) && ifDepth > 0)
+                ifDepth--;
+
+            continue;
+        }
+
+        // variables aren't known yet, the parser gets to those itself
+        if (ifDepth > 0 || TOKENS.type != LINETYPE_ASSIGNMENT || TOKENS.key != "source" || TOKENS.value.contains('$'))
+            continue;
+
+        if (auto paths = resolveSourcePaths(TOKENS.value, BASEDIR); paths)
+            found.insert(found.end(), std::make_move_iterator(paths->begin()), std::make_move_iterator(paths->end()));
+    }
+
+    if (found.empty())
+        return;
+
+    std::lock_guard lock(m_mutex);
+
+    // read for a parse that's over
+    if (generation != m_generation)
+        return;
+
+    for (auto& p : found) {
+        if (m_entries.try_emplace(p).second)
+            m_queue.emplace_back(std::move(p));
+    }
+
+    while (!m_bStopped && m_workers.size() < MAX_PREFETCH_WORKERS && m_workers.size() < m_queue.size() + m_active) {
+        m_workers.emplace_back([this] { work(); });
+    }
+
+    m_cv.notify_all();
+}
+
+void CSourcePrefetcher::work() {
+    std::unique_lock lock(m_mutex);
+
+    while (true) {
+        // idle workers stay for the next parse
+        m_cv.wait(lock, [this] { return m_bStopped || !m_queue.empty(); });
+
+        if (m_bStopped)
+            return;
+
+        const std::string PATH       = std::move(m_queue.front());
+        const auto        GENERATION = m_generation;
+        m_queue.pop_front();
+        m_active++;
+        lock.unlock();
+
+        // scanning it also faults the whole mapping in
+        auto source = std::make_shared<CConfigSource>(PATH.c_str());
+        if (source->good())
+            queueFrom(source->data(), PATH, GENERATION);
+
+        lock.lock();
+        m_active--;
+
+        if (GENERATION != m_generation)
+            continue;
+
+        auto& entry  = m_entries[PATH];
+        entry.source = std::move(source);
+        entry.done   = true;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "reader.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// the files a source = value names, sorted. ~ is $HOME, relative paths start at baseDir, globs are expanded.
+std::expected<std::vector<std::string>, std::string> resolveSourcePaths(std::string_view value, const std::string& baseDir);
+
+/*
+    Reads every file reachable through source = lines ahead of the parser, on a few threads kept across parses.
+    Only a guess from the raw text: values with variables and lines in hyprlang if blocks are skipped.
+    The parser still decides what gets parsed and in which order, and reads anything missed itself.
+*/
+class CSourcePrefetcher {
+  public:
+    CSourcePrefetcher() = default;
+    ~CSourcePrefetcher();
+
+    CSourcePrefetcher(const CSourcePrefetcher&)            = delete;
+    CSourcePrefetcher& operator=(const CSourcePrefetcher&) = delete;
+
+    // forgets the files of the last parse and queues the ones rootData sources
+    void                           start(std::string_view rootData, const std::string& rootPath);
+    // drops everything queued or read, the workers wait for the next start()
+    void                           stop();
+
+    // the file, waiting for it if it's still being read. nullptr if it was never queued.
+    std::shared_ptr<CConfigSource> take(const std::string& path);
+
+  private:
+    struct SEntry {
+        std::shared_ptr<CConfigSource> source;
+        bool                           done = false;
+    };
+
+    void                                    queueFrom(std::string_view data, const std::string& path, size_t generation);
+    void                                    work();
+
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_cv;
+    std::unordered_map<std::string, SEntry> m_entries; // every file queued so far, the include graph's nodes
+    std::deque<std::string>                 m_queue;
+    size_t                                  m_active     = 0; // being read right now
+    size_t                                  m_generation = 0; // bumped by start() and stop(), reads for an older one are thrown away
+    bool                                    m_bStopped   = false;
+    std::vector<std::thread>                m_workers;
+};
@@ -0,0 +1,108 @@
+#include "tokenizer.hpp"
+
+#include <cctype>
+
+std::string_view trimView(std::string_view str) {
+    while (!str.empty() && std::isspace((unsigned char)str.front())) {
+        str.remove_prefix(1);
+    }
+
+    while (!str.empty() && std::isspace((unsigned char)str.back())) {
+        str.remove_suffix(1);
+    }
+
+    return str;
+}
+
+SLineTokens tokenizeLine(std::string_view line, std::string& scratch) {
+    SLineTokens tokens;
+
+    line = trimView(line);
+
+    if (line.empty())
+        return tokens;
+
+    if (line.front() == '#') {
+        tokens.comment = line.substr(1);
+        tokens.type    = trimView(tokens.comment).starts_with("hyprlang") ? LINETYPE_DIRECTIVE : LINETYPE_COMMENT;
+        return tokens;
+    }
+
+    std::string_view body     = line;
+    const auto       FIRSTPOS = line.find('#');
+
+    if (FIRSTPOS != std::string_view::npos) {
+        if (FIRSTPOS + 1 >= line.length() || line[FIRSTPOS + 1] != '#') {
+            body           = line.substr(0, FIRSTPOS);
+            tokens.comment = line.substr(FIRSTPOS + 1);
+        } else {
+            // ## is an escaped #. It collapses into one, and the char right after it is taken verbatim.
+            scratch.clear();
+            scratch.reserve(line.length());
+
+            size_t i = 0;
+            while (i < line.length()) {
+                if (line[i] != '#') {
+                    scratch += line[i++];
+                    continue;
+                }
+
+                if (i + 1 < line.length() && line[i + 1] == '#') {
+                    scratch += '#';
+                    if (i + 2 < line.length())
+                        scratch += line[i + 2];
+                    i += 3;
+                    continue;
+                }
+
+                tokens.comment = line.substr(i + 1);
+                break;
+            }
+
+            body = scratch;
+        }
+    }
+
+    body = trimView(body);
+
+    if (body.empty())
+        return tokens;
+
+    const auto EQUALSPOS = body.find('=');
+
+    if (EQUALSPOS == std::string_view::npos) {
+        if (!body.ends_with('{') && body != "}") {
+            tokens.type  = LINETYPE_INVALID;
+            tokens.error = "Invalid config line";
+            return tokens;
+        }
+
+        if (body.contains('}')) {
+            if (body != "}") {
+                tokens.type  = LINETYPE_INVALID;
+                tokens.error = "Invalid config line";
+                return tokens;
+            }
+
+            tokens.type = LINETYPE_CATEGORY_CLOSE;
+            return tokens;
+        }
+
+        tokens.type = LINETYPE_CATEGORY_OPEN;
+        tokens.key  = trimView(body.substr(0, body.length() - 1));
+        return tokens;
+    }
+
+    tokens.key   = trimView(body.substr(0, EQUALSPOS));
+    tokens.value = trimView(body.substr(EQUALSPOS + 1));
+
+    if (tokens.key.empty()) {
+        tokens.type  = LINETYPE_INVALID;
+        tokens.error = "Empty lhs.";
+        return tokens;
+    }
+
+    tokens.type = tokens.key.front() == '$' ? LINETYPE_VARIABLE : LINETYPE_ASSIGNMENT;
+
+    return tokens;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+enum eLineType : uint8_t {
+    LINETYPE_EMPTY = 0,
+    LINETYPE_COMMENT,
+    LINETYPE_DIRECTIVE, // # hyprlang ...
+    LINETYPE_CATEGORY_OPEN,
+    LINETYPE_CATEGORY_CLOSE,
+    LINETYPE_ASSIGNMENT,
+    LINETYPE_VARIABLE,
+    LINETYPE_INVALID,
+};
+
+struct SLineTokens {
+    eLineType        type = LINETYPE_EMPTY;
+
+    std::string_view key;     // lhs of an assignment / variable, name of an opened category
+    std::string_view value;   // rhs of an assignment / variable
+    std::string_view comment; // everything after the first unescaped #
+
+    const char*      error = nullptr; // set for LINETYPE_INVALID
+};
+
+std::string_view trimView(std::string_view str);
+
+/*
+    Classifies a raw config line in a single pass.
+    Views point into line, or into scratch if ## escapes had to be collapsed,
+    so both have to outlive the returned tokens.
+*/
+SLineTokens tokenizeLine(std::string_view line, std::string& scratch);
@@ -0,0 +1,73 @@
+#include "trace.hpp"
+
+#include <format>
+#include <iterator>
+
+using namespace Hyprlang;
+
+static void appendEscaped(std::string& out, const char* str) {
+    for (; *str; ++str) {
+        switch (*str) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)*str < 0x20)
+                    std::format_to(std::back_inserter(out), "\\u{:04x}", (unsigned char)*str);
+                else
+                    out += *str;
+        }
+    }
+}
+
+static const char* spanCategory(eTraceSpan span) {
+    switch (span) {
+        case TRACE_SPAN_PARSE: return "parse";
+        case TRACE_SPAN_FILE: return "file";
+        case TRACE_SPAN_HANDLER: return "handler";
+        case TRACE_SPAN_CUSTOM_VALUE: return "custom_value";
+    }
+
+    return "unknown";
+}
+
+CChromeTraceWriter::~CChromeTraceWriter() {
+    if (m_file.is_open())
+        m_file << "\n]}\n";
+}
+
+bool CChromeTraceWriter::open(const char* path) {
+    m_file.open(path, std::ios::out | std::ios::trunc);
+    if (!m_file.good())
+        return false;
+
+    m_file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    return true;
+}
+
+void CChromeTraceWriter::write(const STraceEvent& event) {
+    m_line.clear();
+    m_line += m_bFirst ? "\n" : ",\n";
+    m_bFirst = false;
+
+    m_line += "{\"name\": \"";
+    appendEscaped(m_line, event.name);
+    // ts is in microseconds
+    std::format_to(std::back_inserter(m_line), "\", \"cat\": \"{}\", \"ph\": \"{}\", \"ts\": {:.3f}, \"pid\": 1, \"tid\": 1", spanCategory(event.span), event.begin ? 'B' : 'E',
+                   event.timestamp / 1000.0);
+
+    if (event.file || event.line) {
+        m_line += ", \"args\": {\"file\": \"";
+        appendEscaped(m_line, event.file ? event.file : "");
+        std::format_to(std::back_inserter(m_line), "\", \"line\": {}}}", event.line);
+    }
+
+    m_line += '}';
+
+    m_file << m_line;
+}
+
+void CChromeTraceWriter::callback(const STraceEvent& event, void* data) {
+    reinterpret_cast<CChromeTraceWriter*>(data)->write(event);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "public.hpp"
+
+#include <fstream>
+#include <string>
+
+/*
+    Writes trace events as a Chrome trace event JSON file, one event per line.
+    The file is only valid JSON once the writer is destroyed.
+*/
+class CChromeTraceWriter {
+  public:
+    ~CChromeTraceWriter();
+
+    bool        open(const char* path);
+    void        write(const Hyprlang::STraceEvent& event);
+
+    // for CConfig::setTraceCallback, data is the writer
+    static void callback(const Hyprlang::STraceEvent& event, void* data);
+
+  private:
+    std::ofstream m_file;
+    bool          m_bFirst = true;
+    std::string   m_line;
+};
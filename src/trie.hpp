@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <cstdint>
+
+/*
+    A small byte-wise prefix trie. Nodes live in one vector and children are
+    kept in short unsorted edge lists, which is plenty for config identifiers.
+    Erasing only drops the value, nodes are reclaimed on clear().
+*/
+template <typename T>
+class CPrefixTrie {
+  public:
+    void insert(std::string_view key, T value) {
+        uint32_t node = 0;
+        for (const char c : key) {
+            uint32_t next = childOf(node, c);
+            if (!next) {
+                next = m_vNodes.size();
+                m_vNodes[node].children.emplace_back(c, next);
+                m_vNodes.emplace_back();
+            }
+            node = next;
+        }
+
+        m_vNodes[node].value = std::move(value);
+    }
+
+    void erase(std::string_view key) {
+        const auto NODE = nodeOf(key);
+        if (NODE)
+            m_vNodes[*NODE].value.reset();
+    }
+
+    void clear() {
+        m_vNodes.clear();
+        m_vNodes.emplace_back();
+    }
+
+    T* find(std::string_view key) {
+        const auto NODE = nodeOf(key);
+        if (!NODE || !m_vNodes[*NODE].value)
+            return nullptr;
+        return &*m_vNodes[*NODE].value;
+    }
+
+    /*
+        Find the longest key that str starts with.
+        len receives the length of the matched key.
+    */
+    T* longestPrefix(std::string_view str, size_t* len = nullptr) {
+        T*       found = nullptr;
+        uint32_t node  = 0;
+
+        for (size_t i = 0;; ++i) {
+            if (m_vNodes[node].value) {
+                found = &*m_vNodes[node].value;
+                if (len)
+                    *len = i;
+            }
+
+            if (i >= str.length())
+                break;
+
+            node = childOf(node, str[i]);
+            if (!node)
+                break;
+        }
+
+        return found;
+    }
+
+    /*
+        Call fn(len, value) for every key that str starts with, shortest first.
+    */
+    template <typename F>
+    void forEachPrefix(std::string_view str, F&& fn) {
+        uint32_t node = 0;
+
+        for (size_t i = 0;; ++i) {
+            if (m_vNodes[node].value)
+                fn(i, *m_vNodes[node].value);
+
+            if (i >= str.length())
+                break;
+
+            node = childOf(node, str[i]);
+            if (!node)
+                break;
+        }
+    }
+
+  private:
+    struct SNode {
+        std::vector<std::pair<char, uint32_t>> children;
+        std::optional<T>                       value;
+    };
+
+    // the root always exists, so 0 doubles as "no child"
+    std::vector<SNode> m_vNodes = std::vector<SNode>(1);
+
+    uint32_t           childOf(uint32_t node, char c) const {
+        for (const auto& [ch, idx] : m_vNodes[node].children) {
+            if (ch == c)
+                return idx;
+        }
+
+        return 0;
+    }
+
+    std::optional<uint32_t> nodeOf(std::string_view key) const {
+        uint32_t node = 0;
+        for (const char c : key) {
+            node = childOf(node, c);
+            if (!node)
+                return std::nullopt;
+        }
+
+        return node;
+    }
+};
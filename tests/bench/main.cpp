@@ -0,0 +1,269 @@
+// Parse throughput and getter latency on generated configs.
+// Not part of ctest, build with `make bench` and run ./hyprlang_bench [scale...]
+// Every result is one JSON object per line, so runs can be diffed or fed to jq.
+
+#include <hyprlang.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// count every allocation in the process, the library's included
+static std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+struct SGeneratorSpec {
+    size_t values     = 0; // plain top level values
+    size_t categories = 0; // nested categories, two levels deep
+    size_t specials   = 0; // keyed and anonymous special categories, half each
+    size_t variables  = 0; // chained, every one references the one before
+    size_t handlers   = 0; // handler lines
+};
+
+struct SGenerated {
+    std::string              config;
+    std::vector<std::string> valueNames;
+    std::vector<std::string> specialKeys;
+    size_t                   lines = 0;
+};
+
+// same spec and seed, same config. Nothing depends on the environment.
+static SGenerated generate(const SGeneratorSpec& spec, uint32_t seed) {
+    SGenerated   out;
+    std::mt19937 rng(seed);
+
+    auto         line = [&out](std::string str) {
+        out.config += str;
+        out.config += '\n';
+        out.lines++;
+    };
+
+    for (size_t i = 0; i < spec.variables; ++i) {
+        line(i == 0 ? "$var0 = 10" : std::format("$var{} = $var{}", i, i - 1));
+    }
+
+    for (size_t i = 0; i < spec.values; ++i) {
+        const auto NAME = std::format("value{}", i);
+        out.valueNames.emplace_back(NAME);
+
+        switch (i % 6) {
+            case 0: line(std::format("{} = {}", NAME, rng() % 1000)); break;
+            case 1: line(std::format("{} = {}.{}", NAME, rng() % 100, rng() % 100)); break;
+            case 2: line(std::format("{} = some string {}", NAME, rng())); break;
+            case 3: line(std::format("{} = rgba({:08x})", NAME, rng())); break;
+            case 4: line(std::format("{} = rgb({}, {}, {})", NAME, rng() % 256, rng() % 256, rng() % 256)); break;
+            case 5:
+                if (spec.variables > 0)
+                    line(std::format("{} = {{{{ $var{} + {} }}}}", NAME, rng() % spec.variables, rng() % 100));
+                else
+                    line(std::format("{} = {} {}", NAME, rng() % 1000, rng() % 1000));
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < spec.categories; ++i) {
+        line(std::format("cat{} {{", i));
+        line(std::format("    size = {}", rng() % 100));
+        line("    inner {");
+        line(std::format("        color = 0x{:08x}", rng()));
+        line(std::format("        offset = {} {}", rng() % 100, rng() % 100));
+        line("    }");
+        line("}");
+    }
+
+    for (size_t i = 0; i < spec.specials; ++i) {
+        if (i % 2 == 0) {
+            const auto KEY = std::format("device{}", i);
+            out.specialKeys.emplace_back(KEY);
+            line(std::format("device[{}] {{", KEY));
+            line(std::format("    sensitivity = {}.{}", rng() % 2, rng() % 100));
+            line(std::format("    accel = {}", rng() % 3));
+            line("}");
+        } else {
+            line("rule {");
+            line(std::format("    match = class:app{}", rng() % 100));
+            line(std::format("    opacity = 0.{}", rng() % 100));
+            line("}");
+        }
+    }
+
+    for (size_t i = 0; i < spec.handlers; ++i) {
+        line(std::format("bind = SUPER, {}, exec, app{}", (char)('A' + rng() % 26), rng() % 1000));
+    }
+
+    return out;
+}
+
+static Hyprlang::CParseResult handleBind(const char* command, const char* value) {
+    return Hyprlang::CParseResult{};
+}
+
+static void setup(Hyprlang::CConfig& config, const SGeneratorSpec& spec) {
+    for (size_t i = 0; i < spec.values; ++i) {
+        const auto NAME = std::format("value{}", i);
+        switch (i % 6) {
+            case 0: config.addConfigValue(NAME.c_str(), (Hyprlang::INT)0); break;
+            case 1: config.addConfigValue(NAME.c_str(), (Hyprlang::FLOAT)0); break;
+            case 2: config.addConfigValue(NAME.c_str(), (Hyprlang::STRING) ""); break;
+            case 3:
+            case 4: config.addConfigValue(NAME.c_str(), (Hyprlang::INT)0); break;
+            case 5:
+                if (spec.variables > 0)
+                    config.addConfigValue(NAME.c_str(), (Hyprlang::INT)0);
+                else
+                    config.addConfigValue(NAME.c_str(), Hyprlang::VEC2{0, 0});
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < spec.categories; ++i) {
+        config.addConfigValue(std::format("cat{}:size", i).c_str(), (Hyprlang::INT)0);
+        config.addConfigValue(std::format("cat{}:inner:color", i).c_str(), (Hyprlang::INT)0);
+        config.addConfigValue(std::format("cat{}:inner:offset", i).c_str(), Hyprlang::VEC2{0, 0});
+    }
+
+    config.addSpecialCategory("device", {.key = "name"});
+    config.addSpecialConfigValue("device", "sensitivity", (Hyprlang::FLOAT)0);
+    config.addSpecialConfigValue("device", "accel", (Hyprlang::INT)0);
+
+    config.addSpecialCategory("rule", {.key = nullptr, .ignoreMissing = false, .anonymousKeyBased = true});
+    config.addSpecialConfigValue("rule", "match", (Hyprlang::STRING) "");
+    config.addSpecialConfigValue("rule", "opacity", (Hyprlang::FLOAT)1);
+
+    config.registerHandler(&handleBind, "bind", {.allowFlags = false});
+
+    config.commence();
+}
+
+struct SMeasurement {
+    double nsPerOp     = 0;
+    double allocsPerOp = 0;
+};
+
+template <typename F>
+static SMeasurement measure(size_t ops, F&& fn) {
+    const auto ALLOCSBEFORE = allocations.load();
+    const auto BEGIN        = std::chrono::steady_clock::now();
+
+    fn();
+
+    const auto NS     = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - BEGIN).count();
+    const auto ALLOCS = allocations.load() - ALLOCSBEFORE;
+
+    return SMeasurement{.nsPerOp = (double)NS / ops, .allocsPerOp = (double)ALLOCS / ops};
+}
+
+static void report(const char* bench, size_t scale, const SGenerated& gen, size_t ops, const SMeasurement& m) {
+    std::cout << std::format(R"({{"bench": "{}", "scale": {}, "lines": {}, "bytes": {}, "ops": {}, "ns_per_op": {:.1f}, "allocs_per_op": {:.2f}}})", bench, scale, gen.lines,
+                             gen.config.size(), ops, m.nsPerOp, m.allocsPerOp)
+              << "\n";
+}
+
+static void runScale(size_t scale) {
+    const SGeneratorSpec SPEC = {
+        .values     = 60 * scale,
+        .categories = 10 * scale,
+        .specials   = 10 * scale,
+        .variables  = 10 * scale,
+        .handlers   = 20 * scale,
+    };
+
+    const auto        GEN = generate(SPEC, 1337);
+
+    Hyprlang::CConfig config(GEN.config.c_str(), {.pathIsStream = true});
+    setup(config, SPEC);
+
+    // warm up, the first parse also creates the special categories
+    if (const auto RESULT = config.parse(); RESULT.error) {
+        std::cerr << "generated config failed to parse: " << RESULT.getError() << "\n";
+        std::exit(1);
+    }
+
+    const size_t PARSES = std::max<size_t>(1, 200 / scale);
+    auto         parse  = measure(PARSES, [&] {
+        for (size_t i = 0; i < PARSES; ++i) {
+            config.parse();
+        }
+    });
+    report("parse", scale, GEN, PARSES, parse);
+
+    // per line as well, that's what scales
+    parse.nsPerOp /= GEN.lines;
+    parse.allocsPerOp /= GEN.lines;
+    report("parse_per_line", scale, GEN, PARSES * GEN.lines, parse);
+
+    std::vector<std::string> dynamicLines;
+    for (size_t i = 0; i < GEN.valueNames.size(); i += 6) {
+        dynamicLines.emplace_back(std::format("{} = {}", GEN.valueNames[i], i));
+    }
+
+    report("parseDynamic", scale, GEN, dynamicLines.size(), measure(dynamicLines.size(), [&] {
+               for (const auto& l : dynamicLines) {
+                   config.parseDynamic(l.c_str());
+               }
+           }));
+
+    constexpr size_t GETTER_ROUNDS = 100;
+
+    report("getConfigValuePtr", scale, GEN, GEN.valueNames.size() * GETTER_ROUNDS, measure(GEN.valueNames.size() * GETTER_ROUNDS, [&] {
+               for (size_t r = 0; r < GETTER_ROUNDS; ++r) {
+                   for (const auto& name : GEN.valueNames) {
+                       if (!config.getConfigValuePtr(name.c_str()))
+                           std::abort();
+                   }
+               }
+           }));
+
+    report("getSpecialConfigValuePtr", scale, GEN, GEN.specialKeys.size() * GETTER_ROUNDS, measure(GEN.specialKeys.size() * GETTER_ROUNDS, [&] {
+               for (size_t r = 0; r < GETTER_ROUNDS; ++r) {
+                   for (const auto& key : GEN.specialKeys) {
+                       if (!config.getSpecialConfigValuePtr("device", "sensitivity", key.c_str()))
+                           std::abort();
+                   }
+               }
+           }));
+
+    report("listKeysForSpecialCategory", scale, GEN, GETTER_ROUNDS, measure(GETTER_ROUNDS, [&] {
+               for (size_t r = 0; r < GETTER_ROUNDS; ++r) {
+                   if (config.listKeysForSpecialCategory("device").size() != GEN.specialKeys.size())
+                       std::abort();
+               }
+           }));
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> scales;
+    for (int i = 1; i < argc; ++i) {
+        scales.emplace_back(std::stoull(argv[i]));
+    }
+
+    if (scales.empty())
+        scales = {1, 10, 100};
+
+    for (const auto S : scales) {
+        runScale(S);
+    }
+
+    return 0;
+}
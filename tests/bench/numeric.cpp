@@ -0,0 +1,101 @@
+// Compares the from_chars based parsers in src/numeric.cpp with the sto* + try/catch code they replaced.
+// Not part of ctest, build with `make bench` and run ./hyprlang_bench_numeric
+
+#include "numeric.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr size_t ITERATIONS = 20;
+
+static volatile int64_t sink = 0;
+
+static std::vector<std::string> makeInts(std::mt19937& rng, bool valid) {
+    std::vector<std::string>               out;
+    std::uniform_int_distribution<int64_t> dist(-100000000, 100000000);
+    for (size_t i = 0; i < 10000; ++i) {
+        out.emplace_back(std::to_string(dist(rng)));
+        if (!valid)
+            out.back() += "px";
+    }
+    return out;
+}
+
+static std::vector<std::string> makeHex(std::mt19937& rng, bool valid) {
+    std::vector<std::string>                out;
+    std::uniform_int_distribution<uint32_t> dist;
+    char                                    buf[16];
+    for (size_t i = 0; i < 10000; ++i) {
+        snprintf(buf, sizeof(buf), valid ? "0x%08x" : "0x%07xz", dist(rng));
+        out.emplace_back(buf);
+    }
+    return out;
+}
+
+static std::vector<std::string> makeFloats(std::mt19937& rng, bool valid) {
+    std::vector<std::string>              out;
+    std::uniform_real_distribution<float> dist(-1000.F, 1000.F);
+    for (size_t i = 0; i < 10000; ++i) {
+        out.emplace_back(valid ? std::to_string(dist(rng)) : "abc" + std::to_string(i));
+    }
+    return out;
+}
+
+template <typename F>
+static void run(const char* name, const std::vector<std::string>& inputs, F&& fn) {
+    const auto BEGIN = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        for (const auto& in : inputs) {
+            sink = sink + fn(in);
+        }
+    }
+    const auto NS = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - BEGIN).count();
+    std::cout << name << ": " << (double)NS / (ITERATIONS * inputs.size()) << " ns/op\n";
+}
+
+static int64_t legacyInt(const std::string& str) {
+    try {
+        size_t pos = 0;
+        auto   v   = std::stoll(str, &pos);
+        return pos == str.length() ? v : 0;
+    } catch (std::exception& e) { return 0; }
+}
+
+static int64_t legacyHex(const std::string& str) {
+    try {
+        size_t pos = 0;
+        auto   v   = std::stoll(str, &pos, 16);
+        return pos == str.length() ? v : 0;
+    } catch (std::exception& e) { return 0; }
+}
+
+static int64_t legacyFloat(const std::string& str) {
+    try {
+        return std::stof(str);
+    } catch (std::exception& e) { return 0; }
+}
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(1337);
+
+    for (const bool VALID : {true, false}) {
+        std::cout << (VALID ? "--- valid input ---\n" : "--- invalid input ---\n");
+
+        const auto INTS   = makeInts(rng, VALID);
+        const auto HEX    = makeHex(rng, VALID);
+        const auto FLOATS = makeFloats(rng, VALID);
+
+        run("int   sto*      ", INTS, legacyInt);
+        run("int   from_chars", INTS, [](const std::string& s) { return parseInt(s).value_or(0); });
+        run("hex   sto*      ", HEX, legacyHex);
+        run("hex   from_chars", HEX, [](const std::string& s) { return parseHexInt(s).value_or(0); });
+        run("float sto*      ", FLOATS, legacyFloat);
+        run("float from_chars", FLOATS, [](const std::string& s) { return (int64_t)parseFloat(s).value_or(0); });
+    }
+
+    return 0;
+}
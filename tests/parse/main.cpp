@@ -1,6 +1,8 @@
 #include <iostream>
 #include <filesystem>
+#include <fstream>
 #include <algorithm>
+#include <thread>
 
 #include <hyprlang.hpp>
 
@@ -76,6 +78,65 @@ static Hyprlang::CParseResult handleSource(const char* COMMAND, const char* VALU
     return pConfig->parseFile(PATH.c_str());
 }
 
+struct STracedSpan {
+    bool                 begin = true;
+    Hyprlang::eTraceSpan span  = Hyprlang::TRACE_SPAN_PARSE;
+    std::string          name, file;
+};
+static std::vector<STracedSpan> tracedSpans;
+
+static void handleTrace(const Hyprlang::STraceEvent& event, void* data) {
+    tracedSpans.emplace_back(STracedSpan{.begin = event.begin, .span = event.span, .name = event.name, .file = event.file ? event.file : ""});
+}
+
+static int         changeListenerCalls = 0;
+static std::string changeListenerBefore, changeListenerAfter;
+
+static void handleChange(std::span<const Hyprlang::SConfigValueChange> changes, void* data) {
+    changeListenerCalls++;
+    changeListenerBefore = std::any_cast<const char*>(changes[0].before);
+    changeListenerAfter  = std::any_cast<const char*>(changes[0].after);
+}
+
+static bool changeListenerReparsed = false;
+
+// sets the value again from inside a listener, once
+static void handleChangeReparse(std::span<const Hyprlang::SConfigValueChange> changes, void* data) {
+    if (changeListenerReparsed)
+        return;
+
+    changeListenerReparsed = true;
+    static_cast<Hyprlang::CConfig*>(data)->parseDynamic("str", "other"); // overwritten in place, where the first parse's string was
+}
+
+static std::thread::id        mainThreadHandlerThread;
+static std::string            mainThreadHandlerSaw;
+
+static Hyprlang::CParseResult handleMainThreadOnly(const char* COMMAND, const char* VALUE) {
+    mainThreadHandlerThread = std::this_thread::get_id();
+    mainThreadHandlerSaw    = std::any_cast<const char*>(pConfig->getConfigValue("b"));
+
+    return Hyprlang::CParseResult();
+}
+
+static Hyprlang::CConfigValue* grabbedValue = nullptr;
+static int64_t                 grabbedSaw   = -1;
+
+static Hyprlang::CParseResult  handleGrab(const char* COMMAND, const char* VALUE) {
+    grabbedValue = pConfig->getConfigValuePtr("a");
+    grabbedSaw   = std::any_cast<int64_t>(grabbedValue->getValue());
+
+    return Hyprlang::CParseResult();
+}
+
+static int                    countedHandlerCalls = 0;
+
+static Hyprlang::CParseResult handleCounted(const char* COMMAND, const char* VALUE) {
+    countedHandlerCalls++;
+
+    return Hyprlang::CParseResult();
+}
+
 static Hyprlang::CParseResult handleSameKeywordSpecialCat(const char* COMMAND, const char* VALUE) {
     sameKeywordSpecialCat = VALUE;
 
@@ -143,6 +204,7 @@ int main(int argc, char** argv, char** envp) {
         config.addConfigValue("categoryKeyword", (Hyprlang::STRING) "");
         config.addConfigValue("testStringQuotes", "");
         config.addConfigValue("testStringRecursive", "");
+        config.addConfigValue("testStringDiamond", "");
         config.addConfigValue("testCategory:testValueInt", (Hyprlang::INT)0);
         config.addConfigValue("testCategory:testValueHex", (Hyprlang::INT)0xA);
         config.addConfigValue("testCategory:nested1:testValueNest", (Hyprlang::INT)0);
@@ -201,6 +263,8 @@ int main(int argc, char** argv, char** envp) {
         const Hyprlang::CConfigValue copyTest = {(Hyprlang::INT)1};
         config.addSpecialConfigValue("specialGeneric:one", "copyTest", copyTest);
 
+        config.setTraceCallback(&handleTrace);
+
         const auto PARSERESULT = config.parse();
         if (PARSERESULT.error) {
             std::cout << "Parse error: " << PARSERESULT.getError() << "\n";
@@ -209,6 +273,19 @@ int main(int argc, char** argv, char** envp) {
 
         EXPECT(PARSERESULT.error, false);
 
+        config.setTraceCallback(nullptr);
+
+        // test trace events
+        std::cout << " → Testing trace events\n";
+        EXPECT(tracedSpans.front().span, Hyprlang::TRACE_SPAN_PARSE);
+        EXPECT(tracedSpans.back().begin, false);
+        EXPECT((size_t)std::ranges::count_if(tracedSpans, [](const auto& e) { return e.begin; }) * 2, tracedSpans.size());
+        // source = ./colors.conf, a file span nested in the source handler's
+        const auto SOURCESPAN = std::ranges::find_if(tracedSpans, [](const auto& e) { return e.span == Hyprlang::TRACE_SPAN_HANDLER && e.name == "source"; });
+        EXPECT(SOURCESPAN != tracedSpans.end(), true);
+        EXPECT(SOURCESPAN->file.ends_with("config.conf"), true);
+        EXPECT((SOURCESPAN + 1)->span, Hyprlang::TRACE_SPAN_FILE);
+
         // test values
         std::cout << " → Testing values\n";
         EXPECT(std::any_cast<int64_t>(config.getConfigValue("testInt")), 123);
@@ -287,10 +364,17 @@ int main(int argc, char** argv, char** envp) {
         EXPECT(barrelRoll, true);
         EXPECT(config.parseDynamic("testCategory:testValueHex", "0xaabbccdd").error, false);
         EXPECT(std::any_cast<int64_t>(config.getConfigValue("testCategory:testValueHex")), (Hyprlang::INT)0xAABBCCDD);
+        EXPECT(config.parseDynamic("testCategory:testColor3", "rgba(A0b1C2d3)").error, false);
+        EXPECT(std::any_cast<int64_t>(config.getConfigValue("testCategory:testColor3")), (Hyprlang::INT)0xD3A0B1C2);
+        EXPECT(config.parseDynamic("testCategory:testColor3", "rgb(a0b1g2)").error, true);
         EXPECT(config.parseDynamic("testStringColon", "1:3:3:7").error, false);
         EXPECT(std::any_cast<const char*>(config.getConfigValue("testStringColon")), std::string{"1:3:3:7"});
+        EXPECT(config.parseDynamic("testStringColon", "1:3:3:7").error, false);
+        EXPECT(config.getChanges().size(), 0);
         EXPECT(config.parseDynamic("flagsStuff:value = 69").error, false);
         EXPECT(std::any_cast<int64_t>(config.getConfigValue("flagsStuff:value")), (Hyprlang::INT)69);
+        EXPECT(config.getChanges().size(), 1);
+        EXPECT(config.getChanges()[0].name, std::string{"flagsStuff:value"});
 
         // test dynamic special
         config.addSpecialConfigValue("specialGeneric:one", "boom", (Hyprlang::INT)0);
@@ -310,6 +394,10 @@ int main(int argc, char** argv, char** envp) {
         EXPECT(config.parseDynamic("$RECURSIVE1 = d").error, false);
         EXPECT(std::any_cast<const char*>(config.getConfigValue("testStringRecursive")), std::string{"dbc"});
 
+        EXPECT(std::any_cast<const char*>(config.getConfigValue("testStringDiamond")), std::string{"abac-ab"});
+        EXPECT(config.parseDynamic("$DIAMOND_A = d").error, false);
+        EXPECT(std::any_cast<const char*>(config.getConfigValue("testStringDiamond")), std::string{"dbdc-db"});
+
         // test expression escape with dynamic vars
         EXPECT(config.parseDynamic("$MOVING_VAR = 500").error, false);
         EXPECT(std::any_cast<const char*>(config.getConfigValue("testDynamicEscapedExpression")), std::string{"{{ moved: 250 expr: {{500 / 2}} }}"});
@@ -405,6 +493,24 @@ int main(int argc, char** argv, char** envp) {
         EXPECT(config.getAnyConfigValuePtr("special]:a[value"), nullptr);
         EXPECT(config.getAnyConfigValuePtr("speciala]:value"), nullptr);
 
+        // test key lookups, including after a key was rewritten
+        EXPECT(config.specialCategoryExistsForKey("special", "a"), true);
+        EXPECT(config.specialCategoryExistsForKey("special", "nonexistent"), false);
+        EXPECT(config.parseDynamic("special[b]:key = renamed").error, false);
+        EXPECT(config.specialCategoryExistsForKey("special", "b"), false);
+        EXPECT(std::any_cast<int64_t>(config.getSpecialConfigValue("special", "value", "renamed")), 420);
+
+        // test value handles
+        auto intHandle     = config.getConfigValueHandle("testInt");
+        auto specialHandle = config.getConfigValueHandle("special[renamed]:value");
+        auto missingHandle = config.getConfigValueHandle("special[later]:value");
+        EXPECT(intHandle.get(), config.getConfigValuePtr("testInt"));
+        EXPECT(specialHandle.get(), config.getSpecialConfigValuePtr("special", "value", "renamed"));
+        EXPECT(missingHandle.get(), nullptr);
+        EXPECT(config.parseDynamic("special[renamed]:key = later").error, false);
+        EXPECT(specialHandle.get(), nullptr);
+        EXPECT(std::any_cast<int64_t>(missingHandle.get()->getValue()), 420);
+
         // test sourcing
         std::cout << " → Testing sourcing\n";
         EXPECT(std::any_cast<int64_t>(config.getConfigValue("myColors:pink")), (Hyprlang::INT)0xFFc800c8);
@@ -419,11 +525,39 @@ int main(int argc, char** argv, char** envp) {
         EXPECT(std::any_cast<const char*>(config.getConfigValue("multiline")), std::string{"very        long            command"});
 
         // test dynamic env
+        config.addChangeListener("testEnv*", &handleChange);
         setenv("TEST_ENV", "2", true);
         config.parse();
         std::cout << " → Testing dynamic env variables\n";
         EXPECT(std::any_cast<const char*>(config.getConfigValue("testEnv2")), std::string{"2"});
 
+        std::cout << " → Testing change sets\n";
+        const auto CHANGES    = config.getChanges();
+        auto       hasChanged = [&CHANGES](const char* name) { return std::ranges::any_of(CHANGES, [name](const auto& c) { return std::string{c.name} == name; }); };
+        EXPECT(hasChanged("testEnv2"), true);
+        EXPECT(hasChanged("testInt"), false);
+        config.parse();
+        EXPECT(config.getChanges().size(), 0);
+
+        std::cout << " → Testing change listeners\n";
+        EXPECT(changeListenerCalls, 1);
+        EXPECT(changeListenerBefore, std::string{"1"});
+        EXPECT(changeListenerAfter, std::string{"2"});
+        config.removeChangeListener("testEnv*", &handleChange);
+        setenv("TEST_ENV", "3", true);
+        config.parse();
+        EXPECT(changeListenerCalls, 1);
+
+        // later listeners still get the value from the parse that called them
+        Hyprlang::CConfig listenerConfig("str = short\n", {.pathIsStream = true});
+        listenerConfig.addConfigValue("str", "");
+        listenerConfig.commence();
+        listenerConfig.addChangeListener("str", &handleChangeReparse, &listenerConfig);
+        listenerConfig.addChangeListener("str", &handleChange);
+        listenerConfig.parse();
+        EXPECT(changeListenerReparsed, true);
+        EXPECT(changeListenerAfter, std::string{"short"});
+
         std::cout << " → Testing error.conf\n";
         Hyprlang::CConfig errorConfig("./config/error.conf", {.verifyOnly = true, .throwAllErrors = true});
 
@@ -433,6 +567,22 @@ int main(int argc, char** argv, char** envp) {
         EXPECT(ERRORS.error, true);
         const auto ERRORSTR = std::string{ERRORS.getError()};
         EXPECT(std::count(ERRORSTR.begin(), ERRORSTR.end(), '\n'), 1);
+        EXPECT(ERRORS.getErrors().size(), 2);
+        EXPECT(ERRORS.getErrors()[0].line, 6);
+        EXPECT(ERRORS.getErrors()[0].column, 5);
+        EXPECT(ERRORS.getErrors()[1].code, Hyprlang::PARSE_ERROR_UNCLOSED_CATEGORY);
+
+        // the records are the result's own, another parse doesn't touch them
+        errorConfig.parse();
+        EXPECT(std::string{ERRORS.getErrors()[1].message}, "Unclosed category at EOF");
+        EXPECT(std::string{ERRORS.getErrors()[0].file}.ends_with("error.conf"), true);
+
+        // a copy joins its own string, it doesn't point into the result it came from
+        std::optional<Hyprlang::CParseResult> original = errorConfig.parse();
+        const auto                            COPY     = *original;
+        original.reset();
+        EXPECT(std::string{COPY.getError()}, ERRORSTR);
+        EXPECT(COPY.getErrors().size(), 2);
 
         std::cout << " → Testing invalid-numbers.conf\n";
         Hyprlang::CConfig invalidNumbersConfig("./config/invalid-numbers.conf", {.throwAllErrors = true});
@@ -463,6 +613,257 @@ int main(int argc, char** argv, char** envp) {
         EXPECT(ERRORSTR3.contains("12"), true);
         // Backslash at end of file
         EXPECT(ERRORSTR3.contains("backslash"), true);
+
+        std::cout << " → Testing parse stats\n";
+        Hyprlang::CConfig statsConfig("$A = 1\n$B = $A\nvalue = {{ $B + 1 }}\nspecial[a] {\n    value = 2\n}\n", {.pathIsStream = true, .collectStats = true});
+        statsConfig.addConfigValue("value", (Hyprlang::INT)0);
+        statsConfig.addSpecialCategory("special", {.key = "key"});
+        statsConfig.addSpecialConfigValue("special", "value", (Hyprlang::INT)0);
+        statsConfig.commence();
+        EXPECT(statsConfig.parse().error, false);
+        EXPECT(std::any_cast<int64_t>(statsConfig.getConfigValue("value")), (Hyprlang::INT)2);
+
+        const auto& STATS = statsConfig.getParseStats();
+        EXPECT(STATS.linesRead, 6);
+        EXPECT(STATS.variableSubstitutions, 2);
+        EXPECT(STATS.expressionsEvaluated, 1);
+        EXPECT(STATS.specialCategoriesCreated, 1);
+        EXPECT(STATS.totalNs > 0, true);
+
+        std::cout << " → Testing snapshots\n";
+        Hyprlang::CConfig snapshotConfig("a = 1\nb = one\ncustom = abc\nspecial[x] {\n    value = 3\n}\n", {.pathIsStream = true, .publishSnapshots = true});
+        snapshotConfig.addConfigValue("a", (Hyprlang::INT)0);
+        snapshotConfig.addConfigValue("b", (Hyprlang::STRING) "");
+        snapshotConfig.addConfigValue("custom", {Hyprlang::CConfigCustomValueType{&handleCustomValueSet, &handleCustomValueDestroy, "def"}});
+        snapshotConfig.addSpecialCategory("special", {.key = "key"});
+        snapshotConfig.addSpecialConfigValue("special", "value", (Hyprlang::INT)0);
+        snapshotConfig.commence();
+        EXPECT(snapshotConfig.getSnapshot() == nullptr, true);
+        snapshotConfig.parse();
+
+        const auto SNAP1 = snapshotConfig.getSnapshot();
+        EXPECT(std::any_cast<int64_t>(SNAP1->getConfigValuePtr("a")->getValue()), 1);
+        EXPECT(std::any_cast<int64_t>(SNAP1->getSpecialConfigValuePtr("special", "value", "x")->getValue()), 3);
+        EXPECT(std::string{std::any_cast<const char*>(SNAP1->getConfigValuePtr("custom")->getValue())}, "abc");
+        EXPECT(snapshotConfig.parseDynamic("b = two").error, false);
+
+        const auto SNAP2 = snapshotConfig.getSnapshot();
+        EXPECT(SNAP2->generation(), SNAP1->generation() + 1);
+        EXPECT(std::string{std::any_cast<const char*>(SNAP1->getConfigValuePtr("b")->getValue())}, "one");
+        EXPECT(std::string{std::any_cast<const char*>(SNAP2->getConfigValuePtr("b")->getValue())}, "two");
+        // unchanged values are shared
+        EXPECT(SNAP1->getConfigValuePtr("a"), SNAP2->getConfigValuePtr("a"));
+        EXPECT(SNAP1->getSpecialConfigValuePtr("special", "value", "x"), SNAP2->getSpecialConfigValuePtr("special", "value", "x"));
+
+        std::cout << " → Testing builtin source\n";
+        Hyprlang::CConfig sourceConfig("./config/sourcing/main.conf", {.builtinSource = true});
+        sourceConfig.addConfigValue("order", (Hyprlang::STRING) "");
+        sourceConfig.addConfigValue("b", (Hyprlang::INT)0);
+        sourceConfig.addConfigValue("leaf", (Hyprlang::STRING) "");
+        sourceConfig.addConfigValue("last", (Hyprlang::INT)0);
+        sourceConfig.commence();
+        EXPECT(sourceConfig.parse().error, false);
+        // main, parts/a.conf, leaf.conf, parts/b.conf, main again
+        EXPECT(std::string{std::any_cast<const char*>(sourceConfig.getConfigValue("order"))}, "b");
+        EXPECT(std::string{std::any_cast<const char*>(sourceConfig.getConfigValue("leaf"))}, "yes");
+        EXPECT(std::any_cast<int64_t>(sourceConfig.getConfigValue("b")), 5);
+        EXPECT(std::any_cast<int64_t>(sourceConfig.getConfigValue("last")), 42);
+
+        Hyprlang::CConfig cycleConfig("./config/sourcing/cycle.conf", {.builtinSource = true});
+        cycleConfig.commence();
+        const auto CYCLERESULT = cycleConfig.parse();
+        EXPECT(CYCLERESULT.error, true);
+        EXPECT(std::string{CYCLERESULT.getError()}.contains("source: cycle"), true);
+
+        // the errors of a file sourced by parseDynamic() are in its result, not in a temporary's
+        const auto DYNAMICSOURCE = sourceConfig.parseDynamic("source", "./config/error.conf");
+        EXPECT(DYNAMICSOURCE.error, true);
+        EXPECT(std::string{DYNAMICSOURCE.getError()}.contains("error.conf"), true);
+        EXPECT(DYNAMICSOURCE.getErrors().size(), 1);
+
+        // sourced files are stepped through like the main one, eleven lines and a last step that finds the end
+        sourceConfig.beginParse();
+        size_t                                sourceSteps = 1;
+        std::optional<Hyprlang::CParseResult> sourceStepResult;
+        while (!(sourceStepResult = sourceConfig.step({.lines = 1}))) {
+            sourceSteps++;
+        }
+        EXPECT(sourceSteps, 12);
+        EXPECT(sourceStepResult->error, false);
+        EXPECT(std::string{std::any_cast<const char*>(sourceConfig.getConfigValue("order"))}, "b");
+        EXPECT(std::any_cast<int64_t>(sourceConfig.getConfigValue("last")), 42);
+
+        std::cout << " → Testing async parsing\n";
+        Hyprlang::CConfig asyncConfig("a = 1\nmain = x\nb = two\nspecial[x] {\n    value = 3\n}\n", {.pathIsStream = true});
+        asyncConfig.addConfigValue("a", (Hyprlang::INT)0);
+        asyncConfig.addConfigValue("b", (Hyprlang::STRING) "one");
+        asyncConfig.addSpecialCategory("special", {.key = "key"});
+        asyncConfig.addSpecialConfigValue("special", "value", (Hyprlang::INT)0);
+        asyncConfig.registerHandler(&handleMainThreadOnly, "main", {.mainThreadOnly = true});
+        asyncConfig.commence();
+        pConfig = &asyncConfig;
+
+        const auto PA      = asyncConfig.getConfigValuePtr("a");
+        auto       pending = asyncConfig.parseAsync();
+        pending.wait();
+        // nothing is applied before applyPending()
+        EXPECT(std::any_cast<int64_t>(PA->getValue()), 0);
+        EXPECT(asyncConfig.specialCategoryExistsForKey("special", "x"), false);
+        EXPECT(mainThreadHandlerSaw, "");
+        EXPECT(asyncConfig.applyPending().error, false);
+        EXPECT(std::any_cast<int64_t>(PA->getValue()), 1);
+        EXPECT(std::any_cast<int64_t>(asyncConfig.getSpecialConfigValue("special", "value", "x")), 3);
+        EXPECT(mainThreadHandlerThread == std::this_thread::get_id(), true);
+        // queued handlers run once everything is applied
+        EXPECT(mainThreadHandlerSaw, "two");
+
+        std::cout << " → Testing stepped parsing\n";
+        EXPECT(asyncConfig.parseDynamic("a = 7").error, false);
+        asyncConfig.beginParse();
+        EXPECT(asyncConfig.step({.lines = 2}).has_value(), false);
+        // restarting or cancelling leaves the values alone
+        asyncConfig.beginParse();
+        EXPECT(asyncConfig.step({.lines = 2}).has_value(), false);
+        asyncConfig.cancelParse();
+        EXPECT(std::any_cast<int64_t>(PA->getValue()), 7);
+
+        asyncConfig.beginParse();
+        size_t                                steps = 0;
+        std::optional<Hyprlang::CParseResult> stepResult;
+        while (!(stepResult = asyncConfig.step({.lines = 2}))) {
+            EXPECT(std::any_cast<int64_t>(PA->getValue()), 7);
+            steps++;
+        }
+        EXPECT(steps, 3);
+        EXPECT(stepResult->error, false);
+        EXPECT(std::any_cast<int64_t>(PA->getValue()), 1);
+
+        std::cout << " → Testing handlers reading values\n";
+        Hyprlang::CConfig grabConfig("a = 3\ngrab = x\n", {.pathIsStream = true});
+        grabConfig.addConfigValue("a", (Hyprlang::INT)0);
+        grabConfig.registerHandler(&handleGrab, "grab", {});
+        grabConfig.commence();
+        pConfig = &grabConfig;
+
+        // parse() goes straight into the values, earlier lines are visible
+        EXPECT(grabConfig.parse().error, false);
+        EXPECT(grabbedSaw, 3);
+        EXPECT(grabbedValue, grabConfig.getConfigValuePtr("a"));
+        // on the worker, getters go to the pending parse, so earlier lines are visible there too
+        EXPECT(grabConfig.parseDynamic("a = 1").error, false);
+        grabbedSaw = -1;
+        grabConfig.parseAsync().wait();
+        EXPECT(grabbedSaw, 3);
+        EXPECT(grabConfig.applyPending().error, false);
+        EXPECT(std::any_cast<int64_t>(grabConfig.getConfigValuePtr("a")->getValue()), 3);
+        // and what they got there outlives schema changes
+        const auto PGRABBED = grabbedValue;
+        grabConfig.registerHandler(&handleNoop, "noop", {});
+        grabConfig.parseAsync().wait();
+        EXPECT(grabConfig.applyPending().error, false);
+        EXPECT(grabbedValue, PGRABBED);
+        EXPECT(std::any_cast<int64_t>(PGRABBED->getValue()), 3);
+        // same for stepping
+        EXPECT(grabConfig.parseDynamic("a = 1").error, false);
+        grabbedSaw = -1;
+        grabConfig.beginParse();
+        while (!grabConfig.step({.lines = 1})) {
+            ;
+        }
+        EXPECT(grabbedSaw, 3);
+
+        std::cout << " → Testing skipping unchanged parses\n";
+        const auto SKIPPATH        = std::filesystem::temp_directory_path() / "hyprlang-skip-test.conf";
+        const auto writeSkipConfig = [&SKIPPATH](const char* contents, int ageSeconds) {
+            std::ofstream(SKIPPATH) << contents;
+            // timestamps can be coarser than the time between writes
+            std::filesystem::last_write_time(SKIPPATH, std::filesystem::file_time_type::clock::now() - std::chrono::seconds(ageSeconds));
+        };
+
+        setenv("SKIP_TEST", "1", true);
+        writeSkipConfig("a = $SKIP_TEST\ncounted = x\n", 30);
+
+        Hyprlang::CConfig skipConfig(SKIPPATH.c_str(), {.skipUnchanged = true});
+        skipConfig.addConfigValue("a", (Hyprlang::INT)0);
+        skipConfig.registerHandler(&handleCounted, "counted", {});
+        skipConfig.commence();
+
+        EXPECT(skipConfig.parse().error, false);
+        EXPECT(skipConfig.parse().error, false);
+        EXPECT(countedHandlerCalls, 1);
+        EXPECT(skipConfig.parse(true).error, false);
+        EXPECT(countedHandlerCalls, 2);
+
+        // dynamic overrides are undone by parsing again
+        EXPECT(skipConfig.parseDynamic("a = 5").error, false);
+        EXPECT(skipConfig.parse().error, false);
+        EXPECT(countedHandlerCalls, 3);
+        EXPECT(std::any_cast<int64_t>(skipConfig.getConfigValue("a")), 1);
+
+        // touched, same contents
+        writeSkipConfig("a = $SKIP_TEST\ncounted = x\n", 20);
+        EXPECT(skipConfig.parse().error, false);
+        EXPECT(countedHandlerCalls, 3);
+
+        // same size, different contents
+        writeSkipConfig("a = $SKIP_TEST\ncounted = y\n", 10);
+        EXPECT(skipConfig.parse().error, false);
+        EXPECT(countedHandlerCalls, 4);
+
+        setenv("SKIP_TEST", "2", true);
+        EXPECT(skipConfig.parse().error, false);
+        EXPECT(countedHandlerCalls, 5);
+        EXPECT(std::any_cast<int64_t>(skipConfig.getConfigValue("a")), 2);
+
+        std::filesystem::remove(SKIPPATH);
+
+        std::cout << " → Testing the cache file\n";
+        const auto CACHECONFIGPATH = std::filesystem::temp_directory_path() / "hyprlang-cache-test.conf";
+        const auto CACHEPATH       = std::filesystem::temp_directory_path() / "hyprlang-cache-test.cache";
+        std::filesystem::remove(CACHEPATH);
+        std::ofstream(CACHECONFIGPATH) << "$GAP = 4\na = $GAP\ncounted = x\nspecial[one] {\n    value = $GAP\n}\n";
+
+        const auto makeCacheConfig = [&CACHECONFIGPATH, &CACHEPATH]() {
+            auto config = std::make_unique<Hyprlang::CConfig>(CACHECONFIGPATH.c_str(), Hyprlang::SConfigOptions{.collectStats = true});
+            config->addConfigValue("a", (Hyprlang::INT)0);
+            config->addSpecialCategory("special", {.key = "key"});
+            config->addSpecialConfigValue("special", "value", (Hyprlang::INT)0);
+            config->registerHandler(&handleCounted, "counted", {});
+            config->commence();
+            config->setCacheFile(CACHEPATH.c_str());
+            return config;
+        };
+
+        const auto CACHEWRITER = makeCacheConfig();
+        EXPECT(CACHEWRITER->parse().error, false);
+        EXPECT(CACHEWRITER->getParseStats().linesRead > 0, true);
+        EXPECT(std::filesystem::exists(CACHEPATH), true);
+        EXPECT(countedHandlerCalls, 6);
+
+        // same files, env and schema: nothing is parsed, handlers are replayed
+        const auto CACHEREADER = makeCacheConfig();
+        EXPECT(CACHEREADER->parse().error, false);
+        EXPECT(CACHEREADER->getParseStats().linesRead, 0);
+        EXPECT(countedHandlerCalls, 7);
+        EXPECT(std::any_cast<int64_t>(CACHEREADER->getConfigValue("a")), 4);
+        EXPECT(std::any_cast<int64_t>(CACHEREADER->getSpecialConfigValue("special", "value", "one")), 4);
+        // variables still know which lines use them
+        EXPECT(CACHEREADER->parseDynamic("$GAP = 6").error, false);
+        EXPECT(std::any_cast<int64_t>(CACHEREADER->getConfigValue("a")), 6);
+        EXPECT(std::any_cast<int64_t>(CACHEREADER->getSpecialConfigValue("special", "value", "one")), 6);
+        // only the first parse() loads the cache
+        EXPECT(CACHEREADER->parse().error, false);
+        EXPECT(CACHEREADER->getParseStats().linesRead > 0, true);
+        EXPECT(std::any_cast<int64_t>(CACHEREADER->getConfigValue("a")), 4);
+
+        std::ofstream(CACHECONFIGPATH) << "$GAP = 5\na = $GAP\ncounted = x\nspecial[one] {\n    value = $GAP\n}\n";
+        const auto CACHEMISS = makeCacheConfig();
+        EXPECT(CACHEMISS->parse().error, false);
+        EXPECT(CACHEMISS->getParseStats().linesRead > 0, true);
+        EXPECT(std::any_cast<int64_t>(CACHEMISS->getConfigValue("a")), 5);
+
+        std::filesystem::remove(CACHECONFIGPATH);
+        std::filesystem::remove(CACHEPATH);
     } catch (const char* e) {
         std::cout << Colors::RED << "Error: " << Colors::RESET << e << "\n";
         return 1;